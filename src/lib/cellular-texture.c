@@ -32,10 +32,26 @@ struct cellular_texture {
 };
 
 
+/* Random number for a cell centre coordinate.  Derived from the seed and
+ * the coordinate's index alone, so a seed always gives the same cells */
+static inline uint32_t cellular_texture_random(uint32_t seed, uint32_t n)
+{
+	n ^= seed * 0x9e3779b9u;
+	n ^= n >> 16;
+	n *= 0x7feb352du;
+	n ^= n >> 15;
+	n *= 0x846ca68bu;
+	n ^= n >> 16;
+
+	return n;
+}
+
+
 static bool cellular_texture_create_details(struct cellular_texture *cell,
-		int diameter)
+		int diameter, uint32_t seed)
 {
 	int i, j, k, index;
+	uint32_t range;
 	int n_cells = diameter / CELL_SIZE + 3;
 	int n_cells_squared;
 	int n_cells_cubed;
@@ -59,6 +75,7 @@ static bool cellular_texture_create_details(struct cellular_texture *cell,
 		return false;
 
 	/* Make random cell centres */
+	range = 14 * cell_step / 16;
 	index = 0;
 	for (i = 0; i < n_cells; i++) {
 		x_off = (i * CELL_SIZE) << FIX_SHIFT;
@@ -68,14 +85,17 @@ static bool cellular_texture_create_details(struct cellular_texture *cell,
 				z_off = (k * CELL_SIZE) << FIX_SHIFT;
 
 				cell->cells[index].c.x = x_off +
-						rand() % (14 * cell_step / 16) +
-						cell_step / 16;
+						cell_step / 16 +
+						cellular_texture_random(seed,
+							index * 3) % range;
 				cell->cells[index].c.y = y_off +
-						rand() % (14 * cell_step / 16) +
-						cell_step / 16;
+						cell_step / 16 +
+						cellular_texture_random(seed,
+							index * 3 + 1) % range;
 				cell->cells[index].c.z = z_off +
-						rand() % (14 * cell_step / 16) +
-						cell_step / 16;
+						cell_step / 16 +
+						cellular_texture_random(seed,
+							index * 3 + 2) % range;
 				index++;
 			}
 		}
@@ -85,13 +105,14 @@ static bool cellular_texture_create_details(struct cellular_texture *cell,
 }
 
 
-bool cellular_texture_create(struct cellular_texture **cell, int diameter)
+bool cellular_texture_create(struct cellular_texture **cell, int diameter,
+		uint32_t seed)
 {
 	*cell = malloc(sizeof(struct cellular_texture));
 	if (*cell == NULL)
 		return false;
 
-	if (!cellular_texture_create_details(*cell, diameter)) {
+	if (!cellular_texture_create_details(*cell, diameter, seed)) {
 		return false;
 	}
 
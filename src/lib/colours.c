@@ -0,0 +1,156 @@
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+
+#include "colours.h"
+#include "cpu.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define COLOUR_SIMD_X86
+#endif
+
+/* Swap red and blue, between struct colour and XRGB8888, and clear the top
+ * byte.  The swap is its own inverse */
+static inline uint32_t colour_swap_rb(uint32_t px)
+{
+	return ((px & 0xff) << 16) | (px & 0xff00) | ((px >> 16) & 0xff);
+}
+
+#ifdef COLOUR_SIMD_X86
+
+#include <immintrin.h>
+
+#define AVX2 __attribute__((target("avx2")))
+
+/* Shuffle eight pixels per iteration.  Each 32 bit lane gets bytes a, b and
+ * c of the input lane as its bottom three bytes, and zero as its top.
+ * Returns the number of pixels done */
+static AVX2 size_t colour_avx2_shuffle(const uint32_t *in, uint32_t *out,
+		size_t count, char a, char b, char c)
+{
+	const __m256i shuffle = _mm256_setr_epi8(
+			a, b, c, -1, a + 4, b + 4, c + 4, -1,
+			a + 8, b + 8, c + 8, -1, a + 12, b + 12, c + 12, -1,
+			a, b, c, -1, a + 4, b + 4, c + 4, -1,
+			a + 8, b + 8, c + 8, -1, a + 12, b + 12, c + 12, -1);
+	size_t i;
+
+	for (i = 0; i + 8 <= count; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+
+		_mm256_storeu_si256((__m256i *)(out + i),
+				_mm256_shuffle_epi8(v, shuffle));
+	}
+
+	return i;
+}
+
+static size_t colour_simd_shuffle(const uint32_t *in, uint32_t *out,
+		size_t count, char a, char b, char c)
+{
+	if (cpu_get_simd() >= CPU_SIMD_AVX2)
+		return colour_avx2_shuffle(in, out, count, a, b, c);
+
+	return 0;
+}
+
+#else
+
+static size_t colour_simd_shuffle(const uint32_t *in, uint32_t *out,
+		size_t count, char a, char b, char c)
+{
+	(void)(in);
+	(void)(out);
+	(void)(count);
+	(void)(a);
+	(void)(b);
+	(void)(c);
+
+	return 0;
+}
+
+#endif
+
+/* Convert count pixels between struct colour and a layout with a byte per
+ * channel.  in and out may be the same */
+static void colour_convert(enum colour_layout layout,
+		const void *in, size_t count, void *out)
+{
+	const uint32_t *in32 = in;
+	uint32_t *out32 = out;
+	size_t i;
+
+	switch (layout) {
+	case COLOUR_LAYOUT_XBGR8888:
+		i = colour_simd_shuffle(in32, out32, count, 0, 1, 2);
+		for (; i < count; i++)
+			out32[i] = in32[i] & 0x00ffffff;
+		break;
+
+	case COLOUR_LAYOUT_XRGB8888:
+		i = colour_simd_shuffle(in32, out32, count, 2, 1, 0);
+		for (; i < count; i++)
+			out32[i] = colour_swap_rb(in32[i]);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void colour_format_init(struct colour_format *format,
+		const SDL_Surface *screen)
+{
+	const SDL_PixelFormat *f = screen->format;
+
+	format->r_shift = f->Rshift;
+	format->g_shift = f->Gshift;
+	format->b_shift = f->Bshift;
+
+	format->layout = COLOUR_LAYOUT_GENERIC;
+	if (f->BytesPerPixel != 4 || f->Gshift != 8)
+		return;
+
+	if (f->Rshift == 0 && f->Bshift == 16)
+		format->layout = COLOUR_LAYOUT_XBGR8888;
+	else if (f->Rshift == 16 && f->Bshift == 0)
+		format->layout = COLOUR_LAYOUT_XRGB8888;
+}
+
+void colour_texture_to_format(const struct colour_format *format,
+		const struct colour *in, size_t count, uint32_t *out)
+{
+	if (format->layout != COLOUR_LAYOUT_GENERIC) {
+		colour_convert(format->layout, in, count, out);
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		out[i] =
+			(in[i].r << format->r_shift) |
+			(in[i].g << format->g_shift) |
+			(in[i].b << format->b_shift);
+	}
+}
+
+void colour_texture_from_format(const struct colour_format *format,
+		const uint32_t *in, size_t count, struct colour *out)
+{
+	if (format->layout != COLOUR_LAYOUT_GENERIC) {
+		colour_convert(format->layout, in, count, out);
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		uint32_t px = in[i];
+
+		out[i] = (struct colour) {
+			.r = px >> format->r_shift,
+			.g = px >> format->g_shift,
+			.b = px >> format->b_shift,
+		};
+	}
+}
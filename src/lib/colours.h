@@ -2,6 +2,8 @@
 #ifndef _PELTAR_COLOURS_H_
 #define _PELTAR_COLOURS_H_
 
+#include <stddef.h>
+
 #include "fixed-point.h"
 
 struct colour {
@@ -72,22 +74,70 @@ static inline bool colour_different(
 	return *((uint32_t*) a) != *((uint32_t*) b);
 }
 
+/* Screen pixel layouts with specialised conversions from struct colour */
+enum colour_layout {
+	COLOUR_LAYOUT_GENERIC, /* Any channel shifts */
+	COLOUR_LAYOUT_XBGR8888, /* Same byte order as struct colour */
+	COLOUR_LAYOUT_XRGB8888, /* Red and blue swapped */
+};
+
+/* A screen's pixel format, for converting many runs of pixels to it */
+struct colour_format {
+	enum colour_layout layout;
+	uint8_t r_shift;
+	uint8_t g_shift;
+	uint8_t b_shift;
+};
+
+/**
+ * Get a screen's pixel format, and pick the conversion for its layout.
+ *
+ * \param[out] format  Returns the format.
+ * \param[in]  screen  Surface to get the format of.
+ */
+void colour_format_init(struct colour_format *format,
+		const SDL_Surface *screen);
+
+/**
+ * Convert colours to a screen's pixel format.
+ *
+ * \param[in]  format  Format from colour_format_init.
+ * \param[in]  in      Colours to convert.
+ * \param[in]  count   Number of colours.
+ * \param[out] out     Returns the pixels.  May be the same as in.
+ */
+void colour_texture_to_format(const struct colour_format *format,
+		const struct colour *in, size_t count, uint32_t *out);
+
+/**
+ * Inverse of colour_texture_to_format.  in and out may be the same.
+ */
+void colour_texture_from_format(const struct colour_format *format,
+		const uint32_t *in, size_t count, struct colour *out);
+
 static inline void colour_texture_to_screen(
 		const SDL_Surface *screen,
 		const struct colour *in,
 		uint32_t count,
 		uint32_t *out)
 {
-	uint8_t r_shift = screen->format->Rshift;
-	uint8_t g_shift = screen->format->Gshift;
-	uint8_t b_shift = screen->format->Bshift;
-
-	for (size_t i = 0; i < count; i++) {
-		out[i] =
-			(in[i].r << r_shift) |
-			(in[i].g << g_shift) |
-			(in[i].b << b_shift);
-	}
+	struct colour_format format;
+
+	colour_format_init(&format, screen);
+	colour_texture_to_format(&format, in, count, out);
+}
+
+/* Inverse of colour_texture_to_screen.  in and out may be the same */
+static inline void colour_texture_from_screen(
+		const SDL_Surface *screen,
+		const uint32_t *in,
+		uint32_t count,
+		struct colour *out)
+{
+	struct colour_format format;
+
+	colour_format_init(&format, screen);
+	colour_texture_from_format(&format, in, count, out);
 }
 
 #endif
@@ -0,0 +1,33 @@
+
+#include "cpu.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CPU_X86
+#endif
+
+/* Shared by all the SIMD modules; -1 until looked up */
+static int cpu_simd = -1;
+
+void cpu_init(void)
+{
+#ifdef CPU_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		cpu_simd = CPU_SIMD_AVX2;
+	else if (__builtin_cpu_supports("sse4.1"))
+		cpu_simd = CPU_SIMD_SSE41;
+	else
+		cpu_simd = CPU_SIMD_NONE;
+#else
+	cpu_simd = CPU_SIMD_NONE;
+#endif
+}
+
+enum cpu_simd cpu_get_simd(void)
+{
+	if (cpu_simd == -1)
+		cpu_init();
+
+	return cpu_simd;
+}
@@ -0,0 +1,21 @@
+
+#ifndef _PELTAR_CPU_H_
+#define _PELTAR_CPU_H_
+
+/* Vector instruction sets, for picking SIMD kernels at run time.  Later
+ * ones include the earlier ones */
+enum cpu_simd {
+	CPU_SIMD_NONE,
+	CPU_SIMD_SSE41,
+	CPU_SIMD_AVX2,
+};
+
+/* Look up what the CPU has, for every SIMD module at once.  Call before
+ * starting any threads which use SIMD kernels */
+void cpu_init(void);
+
+/* Get the best vector instruction set the CPU has.  Looked up on the first
+ * call, if cpu_init hasn't been called */
+enum cpu_simd cpu_get_simd(void);
+
+#endif
@@ -630,6 +630,47 @@ static inline void level_remove_box(SDL_Surface *screen, SDL_Surface *bg,
 	SDL_BlitSurface(bg, &rect2, screen, &rect1);
 }
 
+static inline bool level_asset_in_rect(const struct asset_pos *pos,
+		const SDL_Rect *r)
+{
+	return pos->x < r->x + r->w && r->x < pos->x + pos->size &&
+	       pos->y < r->y + r->h && r->y < pos->y + pos->size;
+}
+
+/*
+ * Planets only redraw when their rotation has moved them by a whole texel, so
+ * anything else drawn over them must make them redraw.
+ *
+ * l	the level
+ * r	screen area drawn over at the current scale, or NULL for everything
+ */
+static void level_invalidate_planets(struct level *l, const SDL_Rect *r)
+{
+	int i;
+
+	for (i = 0; i < l->nplanets; i++) {
+		if (r == NULL || level_asset_in_rect(&l->planet[i][l->scale], r))
+			planet_invalidate_render(l->planets[i]);
+	}
+
+	for (i = 0; i < PLAYERS_MAX; i++) {
+		if (r == NULL || level_asset_in_rect(&l->player[i][l->scale], r))
+			player_invalidate_render(l->p[i]);
+	}
+}
+
+/* Player direction indicators are removed before being redrawn */
+static void level_invalidate_player_directions(struct level *l)
+{
+	SDL_Rect rect;
+	int i;
+
+	for (i = 0; i < PLAYERS_MAX; i++) {
+		if (player_get_direction_rect(l->p[i], &rect))
+			level_invalidate_planets(l, &rect);
+	}
+}
+
 static void level_render_whole_background(
 		struct level *l, SDL_Surface *screen)
 {
@@ -641,11 +682,15 @@ static void level_render_whole_background(
 		draw_box(screen, 3 * l->width / 8, 3 * l->height / 8,
 				l->width / 4, l->height / 4, 0x00ffffff);
 	}
+
+	level_invalidate_planets(l, NULL);
 }
 
 static void level_update_render_turn_borders(
 		struct level *l, SDL_Surface *screen)
 {
+	level_invalidate_planets(l, NULL);
+
 	switch (l->state) {
 	case TURN_GET_P1_INPUT:
 		draw_box(screen, 0, 0, l->width - 1, l->height - 1,
@@ -739,6 +784,7 @@ static bool level_has_hit_player(struct level *l, struct asset_pos *pos)
 }
 
 static void level_plot_bg_box(
+		struct level *l,
 		SDL_Surface *screen,
 		SDL_Surface *bg,
 		int x0, int y0,
@@ -762,11 +808,12 @@ static void level_plot_bg_box(
 		.h = y1 - y0 + 1,
 	};
 
+	level_invalidate_planets(l, &r);
 	SDL_BlitSurface(bg, &r, screen, &r);
 }
 
 static void level_remove_projectile(
-		const struct level *l,
+		struct level *l,
 		const struct projectile *p,
 		SDL_Surface *screen)
 {
@@ -779,6 +826,7 @@ static void level_remove_projectile(
 			.w = 3,
 			.h = 3
 		};
+		level_invalidate_planets(l, &rect);
 		SDL_BlitSurface(bg, &rect, screen, &rect);
 
 		if (l->state != TURN_SHOW_P1 &&
@@ -846,7 +894,7 @@ static void level__draw_projectile(
 				image_get_surface(l->background[SCALED]),
 				l->colour[player]);
 
-		level_plot_bg_box(screen,
+		level_plot_bg_box(l, screen,
 				image_get_surface(l->background[l->scale]),
 				r[l->scale].a.x,
 				r[l->scale].a.y,
@@ -854,6 +902,15 @@ static void level__draw_projectile(
 				r[l->scale].b.y);
 	}
 
+	/* Planets should cover the shot */
+	SDL_Rect shot = {
+		.x = l->proj.screen[l->scale].x - 1,
+		.y = l->proj.screen[l->scale].y - 1,
+		.w = 3,
+		.h = 3
+	};
+	level_invalidate_planets(l, &shot);
+
 	draw_shot_3x3(screen,
 			l->proj.screen[l->scale].x,
 			l->proj.screen[l->scale].y, l->proj.colour);
@@ -971,6 +1028,14 @@ bool level_update_render(struct level *l, SDL_Surface *screen)
 			(flag_get(l->flags, LEV_STRENGTH_CHANGED))) {
 		int width = l->width / 2;
 		int height = l->height / 64;
+		SDL_Rect rect = {
+			.x = l->width / 4,
+			.y = l->height / 64,
+			.w = width,
+			.h = height
+		};
+
+		level_invalidate_planets(l, &rect);
 
 		if (l->state == TURN_GET_P1_INPUT) {
 			player_render_strength(l->p[PLAYERS_1], screen,
@@ -1003,6 +1068,7 @@ bool level_update_render(struct level *l, SDL_Surface *screen)
 			.w = width,
 			.h = height
 		};
+		level_invalidate_planets(l, &rect2);
 		SDL_BlitSurface(bg, &rect2, screen, &rect1);
 	}
 
@@ -1010,6 +1076,8 @@ bool level_update_render(struct level *l, SDL_Surface *screen)
 			LEV_NEED_REDRAW)) {
 		/* Not showing animations */
 
+		level_invalidate_player_directions(l);
+
 		if (l->scale == SCALED) {
 			player_render_direction_scaled(l->p[PLAYERS_1], screen, bg);
 			player_render_direction_scaled(l->p[PLAYERS_2], screen, bg);
@@ -1027,6 +1095,8 @@ bool level_update_render(struct level *l, SDL_Surface *screen)
 		return false;
 	}
 
+	level_invalidate_player_directions(l);
+
 	if (l->scale == SCALED) {
 		for (i = 0; i < l->nplanets; i++) {
 			planet_update_render_scaled(l->planets[i], screen,
@@ -1063,6 +1133,7 @@ bool level_update_render_full(struct level *l, SDL_Surface *screen)
 {
 	int i;
 	SDL_BlitSurface(level_get_bg_surface(l), NULL, screen, NULL);
+	level_invalidate_planets(l, NULL);
 
 	switch (l->state) {
 	case TURN_GET_P1_INPUT:
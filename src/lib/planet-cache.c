@@ -0,0 +1,214 @@
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "planet-cache.h"
+#include "types.h"
+#include "../noise/noise.h"
+
+
+#define PLANET_CACHE_MAGIC   0x43544c50	/* "PLTC" */
+/* Bump the version whenever the generators' output changes */
+#define PLANET_CACHE_VERSION 2
+#define PLANET_CACHE_PATH_MAX 4096
+
+/* Start of every entry.  Native byte order; the cache isn't meant to be
+ * shared between machines */
+struct planet_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t noise; /* noise_get_variant() */
+	struct planet_cache_key key;
+	uint64_t size;
+};
+
+struct planet_cache {
+	void *map;
+	size_t len;
+};
+
+
+static const char *planet_cache_generator_name[] = {
+	[PLANET_CACHE_EARTH_LIKE] = "earth-like",
+	[PLANET_CACHE_MAN_MADE]   = "man-made",
+};
+
+static bool planet_cache_get_path(char *path, size_t len,
+		const struct planet_cache_key *key)
+{
+	int n;
+
+	if (peltar_opts.cache_dir == NULL ||
+			key->generator > PLANET_CACHE_MAN_MADE)
+		return false;
+
+	n = snprintf(path, len, "%s/%s-%u-%08x%08x%08x%08x-%06x-v%u-n%x.tex",
+			peltar_opts.cache_dir,
+			planet_cache_generator_name[key->generator],
+			(unsigned)key->diameter,
+			(unsigned)key->seeds[0], (unsigned)key->seeds[1],
+			(unsigned)key->seeds[2], (unsigned)key->seeds[3],
+			(unsigned)key->colour, PLANET_CACHE_VERSION,
+			(unsigned)noise_get_variant());
+
+	return n > 0 && (size_t)n < len;
+}
+
+static void planet_cache_get_header(struct planet_cache_header *h,
+		const struct planet_cache_key *key, size_t size)
+{
+	memset(h, 0, sizeof(*h));
+	h->magic = PLANET_CACHE_MAGIC;
+	h->version = PLANET_CACHE_VERSION;
+	h->noise = noise_get_variant();
+	h->key = *key;
+	h->size = size;
+}
+
+
+bool planet_cache_load(struct planet_cache **entry,
+		const struct planet_cache_key *key, size_t size)
+{
+	char path[PLANET_CACHE_PATH_MAX];
+	struct planet_cache_header h;
+	struct planet_cache *e;
+	struct stat st;
+	size_t len = sizeof(h) + size;
+	void *map;
+	int fd;
+
+	if (!planet_cache_get_path(path, sizeof(path), key))
+		return false;
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	if (fstat(fd, &st) == -1 || (size_t)st.st_size != len) {
+		close(fd);
+		return false;
+	}
+
+	map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	/* Check it's an entry for the key, and not an old format */
+	planet_cache_get_header(&h, key, size);
+	if (memcmp(map, &h, sizeof(h)) != 0) {
+		munmap(map, len);
+		return false;
+	}
+
+	e = malloc(sizeof(*e));
+	if (e == NULL) {
+		munmap(map, len);
+		return false;
+	}
+
+	e->map = map;
+	e->len = len;
+
+	*entry = e;
+	return true;
+}
+
+
+const void *planet_cache_get_data(const struct planet_cache *entry)
+{
+	return (const char *)entry->map + sizeof(struct planet_cache_header);
+}
+
+
+void planet_cache_free(struct planet_cache *entry)
+{
+	munmap(entry->map, entry->len);
+	free(entry);
+}
+
+
+bool planet_cache_store(const struct planet_cache_key *key,
+		const struct planet_cache_plane *planes, unsigned count,
+		unsigned rows)
+{
+	char path[PLANET_CACHE_PATH_MAX];
+	char temp[PLANET_CACHE_PATH_MAX];
+	struct planet_cache_header h;
+	size_t scratch_size = 0;
+	void *scratch = NULL;
+	size_t size = 0;
+	unsigned i, y;
+	bool ok;
+	FILE *f;
+	int n;
+
+	if (!planet_cache_get_path(path, sizeof(path), key))
+		return false;
+
+	/* Write to a temporary file, and rename it into place when it's
+	 * complete, so other processes never see partial entries */
+	n = snprintf(temp, sizeof(temp), "%s.%ld", path, (long)getpid());
+	if (n < 0 || (size_t)n >= sizeof(temp))
+		return false;
+
+	for (i = 0; i < count; i++) {
+		size += planes[i].row_size * rows;
+
+		if (planes[i].convert != NULL &&
+				planes[i].row_size > scratch_size)
+			scratch_size = planes[i].row_size;
+	}
+
+	if (scratch_size > 0) {
+		scratch = malloc(scratch_size);
+		if (scratch == NULL)
+			return false;
+	}
+
+	f = fopen(temp, "wb");
+	if (f == NULL) {
+		free(scratch);
+		return false;
+	}
+
+	planet_cache_get_header(&h, key, size);
+	ok = fwrite(&h, sizeof(h), 1, f) == 1;
+
+	for (i = 0; i < count && ok; i++) {
+		const char *row = planes[i].data;
+
+		for (y = 0; y < rows && ok; y++) {
+			const void *out = row;
+
+			if (planes[i].convert != NULL) {
+				planes[i].convert(planes[i].pw, row, scratch,
+						planes[i].row_size);
+				out = scratch;
+			}
+
+			ok = fwrite(out, planes[i].row_size, 1, f) == 1;
+			row += planes[i].pitch;
+		}
+	}
+
+	free(scratch);
+
+	if (fclose(f) != 0)
+		ok = false;
+
+	if (ok && rename(temp, path) == 0)
+		return true;
+
+	remove(temp);
+	return false;
+}
+
@@ -0,0 +1,57 @@
+
+#ifndef _PELTAR_PLANET_CACHE_H_
+#define _PELTAR_PLANET_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * On-disk cache of generated planet textures.
+ *
+ * Entries live in peltar_opts.cache_dir, if it's set, one file per key.
+ * What an entry's data holds is up to the caller; the cache only checks
+ * that it's the expected size.  Entries are also keyed by the noise
+ * variant, so textures from other fade curves or noise hashes aren't used.
+ */
+
+enum planet_cache_generator {
+	PLANET_CACHE_EARTH_LIKE,
+	PLANET_CACHE_MAN_MADE,
+};
+
+/* Everything a generated texture depends on */
+struct planet_cache_key {
+	uint32_t generator;	/* enum planet_cache_generator */
+	uint32_t diameter;
+	uint32_t seeds[4];
+	uint32_t colour;	/* Man-made planet colour, r, g, b bytes */
+};
+
+/* Rows of data to store, each row_size bytes, and pitch bytes apart.  If
+ * convert is set, each row is passed through it, with pw, into a scratch
+ * row which is stored instead */
+struct planet_cache_plane {
+	const void *data;
+	size_t row_size;
+	size_t pitch;
+	void (*convert)(const void *pw, const void *row, void *out,
+			size_t row_size);
+	const void *pw;
+};
+
+struct planet_cache;
+
+/* Map the entry for key, if there is one with size bytes of data */
+bool planet_cache_load(struct planet_cache **entry,
+		const struct planet_cache_key *key, size_t size);
+const void *planet_cache_get_data(const struct planet_cache *entry);
+void planet_cache_free(struct planet_cache *entry);
+
+/* Store planes, each with rows rows, one after the other as key's entry */
+bool planet_cache_store(const struct planet_cache_key *key,
+		const struct planet_cache_plane *planes, unsigned count,
+		unsigned rows);
+
+#endif
+
@@ -0,0 +1,277 @@
+
+#include <stddef.h>
+
+#include "cpu.h"
+#include "planet-simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PLANET_SIMD_X86
+#endif
+
+#ifdef PLANET_SIMD_X86
+
+#include <immintrin.h>
+
+#define AVX2 __attribute__((target("avx2")))
+
+
+/*
+ * AVX2: eight pixels from each quarter of the circle per iteration.
+ */
+
+/* Get the angles for eight pixel cache entries, and their left and right
+ * half lighting values in both 16 bit halves of each 32 bit lane */
+static inline AVX2 __m256i avx2_get_pixels(const struct planet_pixel *pixels,
+		__m256i *left, __m256i *right)
+{
+	__m256i v = _mm256_loadu_si256((const __m256i *)pixels);
+
+	*left = _mm256_and_si256(_mm256_srli_epi32(v, 16),
+			_mm256_set1_epi32(0xff));
+	*right = _mm256_srli_epi32(v, 24);
+
+	*left = _mm256_or_si256(*left, _mm256_slli_epi32(*left, 16));
+	*right = _mm256_or_si256(*right, _mm256_slli_epi32(*right, 16));
+
+	return _mm256_and_si256(v, _mm256_set1_epi32(0xffff));
+}
+
+/* Shade eight texels, as planet_set_pixel_lighting.  Each channel's
+ * product fits in 16 bits, so two channels go in each 32 bit lane */
+static inline AVX2 __m256i avx2_light(__m256i texel, __m256i lighting)
+{
+	__m256i lo, hi;
+
+	lo = _mm256_and_si256(texel, _mm256_set1_epi32(0x00ff00ff));
+	lo = _mm256_srli_epi16(_mm256_mullo_epi16(lo, lighting), 8);
+
+	hi = _mm256_srli_epi16(texel, 8);
+	hi = _mm256_and_si256(_mm256_mullo_epi16(hi, lighting),
+			_mm256_set1_epi32((int)0xff00ff00));
+
+	return _mm256_or_si256(lo, hi);
+}
+
+/* Wrap texture offsets past the end of the texture, if the row span has no
+ * copy of the start of the row there */
+static inline AVX2 __m256i avx2_wrap(__m256i offset, __m256i texture_w)
+{
+#ifdef PLANET_TEXTURE_MODULO
+	__m256i past = _mm256_cmpgt_epi32(offset,
+			_mm256_sub_epi32(texture_w, _mm256_set1_epi32(1)));
+
+	return _mm256_sub_epi32(offset, _mm256_and_si256(past, texture_w));
+#else
+	(void)(texture_w);
+
+	return offset;
+#endif
+}
+
+static AVX2 int planet_avx2_render_span(const struct planet_span *span)
+{
+	const __m256i rot = _mm256_set1_epi32(span->rot);
+	const __m256i rot2 = _mm256_set1_epi32(span->rot2);
+	const __m256i texture_w = _mm256_set1_epi32(span->texture_w);
+	const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+	const __m256i one = _mm256_set1_epi32(1);
+	int i;
+
+	for (i = 0; i + 8 <= span->count; i += 8) {
+		__m256i angle, offset, t_l, b_l, t_r, b_r, l_l, l_r;
+		int x = span->x + i;
+		int right = span->diameter - x - 7;
+
+		angle = avx2_get_pixels(span->pixels + i, &l_l, &l_r);
+
+		/* Texels for the left side, with the angle rounded down */
+		offset = _mm256_add_epi32(rot, _mm256_srli_epi32(angle, 1));
+		offset = avx2_wrap(offset, texture_w);
+		t_l = _mm256_i32gather_epi32((const int *)span->texture_t,
+				offset, 4);
+		b_l = _mm256_i32gather_epi32((const int *)span->texture_b,
+				offset, 4);
+
+		/* Texels for the right side, which has the same angles
+		 * reflected, rounded up */
+		offset = _mm256_sub_epi32(rot2, _mm256_srli_epi32(
+				_mm256_add_epi32(angle, one), 1));
+		offset = avx2_wrap(offset, texture_w);
+		t_r = _mm256_i32gather_epi32((const int *)span->texture_t,
+				offset, 4);
+		b_r = _mm256_i32gather_epi32((const int *)span->texture_b,
+				offset, 4);
+
+		if (span->lighting) {
+			t_l = avx2_light(t_l, l_l);
+			b_l = avx2_light(b_l, l_l);
+			t_r = avx2_light(t_r, l_r);
+			b_r = avx2_light(b_r, l_r);
+		}
+
+		_mm256_storeu_si256((__m256i *)(span->row_t + x), t_l);
+		_mm256_storeu_si256((__m256i *)(span->row_b + x), b_l);
+
+		/* Right side pixels go from right to left */
+		_mm256_storeu_si256((__m256i *)(span->row_t + right),
+				_mm256_permutevar8x32_epi32(t_r, reverse));
+		_mm256_storeu_si256((__m256i *)(span->row_b + right),
+				_mm256_permutevar8x32_epi32(b_r, reverse));
+	}
+
+	return i;
+}
+
+
+/*
+ * AVX2 mip downsampling: each 32 bit texel is widened to four 16 bit
+ * channels, so a 2x2 grid's sums can't overflow.
+ */
+
+/* Sum the channels of the four 2x2 grids in eight texels from each of two
+ * rows.  Each 128 bit lane gets two grids, in order */
+static inline AVX2 __m256i avx2_mip_sum(__m256i t, __m256i b)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i lo, hi;
+
+	lo = _mm256_add_epi16(_mm256_unpacklo_epi8(t, zero),
+			_mm256_unpacklo_epi8(b, zero));
+	hi = _mm256_add_epi16(_mm256_unpackhi_epi8(t, zero),
+			_mm256_unpackhi_epi8(b, zero));
+
+	lo = _mm256_add_epi16(lo, _mm256_bsrli_epi128(lo, 8));
+	hi = _mm256_add_epi16(hi, _mm256_bsrli_epi128(hi, 8));
+
+	return _mm256_unpacklo_epi64(lo, hi);
+}
+
+/* Mean channels of eight grids from sixteen texels of each of two rows,
+ * still widened, as two vectors of four */
+static inline AVX2 void avx2_mip_mean(const uint32_t *t, const uint32_t *b,
+		__m256i *m_a, __m256i *m_b)
+{
+	*m_a = avx2_mip_sum(_mm256_loadu_si256((const __m256i *)t),
+			_mm256_loadu_si256((const __m256i *)b));
+	*m_b = avx2_mip_sum(_mm256_loadu_si256((const __m256i *)(t + 8)),
+			_mm256_loadu_si256((const __m256i *)(b + 8)));
+
+	*m_a = _mm256_srli_epi16(*m_a, 2);
+	*m_b = _mm256_srli_epi16(*m_b, 2);
+}
+
+/* Narrow and store eight texels from avx2_mip_mean */
+static inline AVX2 void avx2_mip_store(uint32_t *out, __m256i m_a, __m256i m_b)
+{
+	__m256i v = _mm256_packus_epi16(m_a, m_b);
+
+	_mm256_storeu_si256((__m256i *)out,
+			_mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+static AVX2 int planet_avx2_mip_row(const uint32_t *t, const uint32_t *b,
+		uint32_t *out, int count)
+{
+	int i;
+
+	for (i = 0; i + 8 <= count; i += 8) {
+		__m256i m_a, m_b;
+
+		avx2_mip_mean(t + 2 * i, b + 2 * i, &m_a, &m_b);
+		avx2_mip_store(out + i, m_a, m_b);
+	}
+
+	return i;
+}
+
+static AVX2 int planet_avx2_mip_rows_4x(const uint32_t *const in[4],
+		uint32_t *const mid[2], uint32_t *out, int count)
+{
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 0, 4, 1, 5);
+	int i;
+
+	for (i = 0; i + 4 <= count; i += 4) {
+		__m256i t_a, t_b, b_a, b_b, s_a, s_b, v;
+
+		avx2_mip_mean(in[0] + 4 * i, in[1] + 4 * i, &t_a, &t_b);
+		avx2_mip_mean(in[2] + 4 * i, in[3] + 4 * i, &b_a, &b_b);
+		avx2_mip_store(mid[0] + 2 * i, t_a, t_b);
+		avx2_mip_store(mid[1] + 2 * i, b_a, b_b);
+
+		/* The next level down from the still widened means: each
+		 * lane of s_a and s_b gets one grid's sums */
+		s_a = _mm256_add_epi16(t_a, b_a);
+		s_b = _mm256_add_epi16(t_b, b_b);
+		s_a = _mm256_add_epi16(s_a, _mm256_bsrli_epi128(s_a, 8));
+		s_b = _mm256_add_epi16(s_b, _mm256_bsrli_epi128(s_b, 8));
+
+		v = _mm256_srli_epi16(_mm256_unpacklo_epi64(s_a, s_b), 2);
+		v = _mm256_packus_epi16(v, v);
+		v = _mm256_permutevar8x32_epi32(v, order);
+
+		_mm_storeu_si128((__m128i *)(out + i),
+				_mm256_castsi256_si128(v));
+	}
+
+	return i;
+}
+
+
+int planet_simd_render_span(const struct planet_span *span)
+{
+	if (cpu_get_simd() >= CPU_SIMD_AVX2)
+		return planet_avx2_render_span(span);
+
+	return 0;
+}
+
+int planet_simd_mip_row(const uint32_t *t, const uint32_t *b,
+		uint32_t *out, int count)
+{
+	if (cpu_get_simd() >= CPU_SIMD_AVX2)
+		return planet_avx2_mip_row(t, b, out, count);
+
+	return 0;
+}
+
+int planet_simd_mip_rows_4x(const uint32_t *const in[4],
+		uint32_t *const mid[2], uint32_t *out, int count)
+{
+	if (cpu_get_simd() >= CPU_SIMD_AVX2)
+		return planet_avx2_mip_rows_4x(in, mid, out, count);
+
+	return 0;
+}
+
+#else
+
+int planet_simd_render_span(const struct planet_span *span)
+{
+	(void)(span);
+
+	return 0;
+}
+
+int planet_simd_mip_row(const uint32_t *t, const uint32_t *b,
+		uint32_t *out, int count)
+{
+	(void)(t);
+	(void)(b);
+	(void)(out);
+	(void)(count);
+
+	return 0;
+}
+
+int planet_simd_mip_rows_4x(const uint32_t *const in[4],
+		uint32_t *const mid[2], uint32_t *out, int count)
+{
+	(void)(in);
+	(void)(mid);
+	(void)(out);
+	(void)(count);
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,91 @@
+
+#ifndef _PELTAR_PLANET_SIMD_H_
+#define _PELTAR_PLANET_SIMD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+
+/*
+ * Angle and lighting cache entry for a pixel in the top left quarter of the
+ * circle, shared with its reflections in the other three quarters.
+ */
+struct planet_pixel {
+	uint16_t angle; /* Texturing angle, fixed point, or scaled to texture */
+	Uint8 lighting[2]; /* Lighting fractions for left and right halves */
+};
+
+/*
+ * A span of a planet render: count consecutive pixels from x of the top
+ * left quarter of the circle, and their reflections in the other three
+ * quarters.
+ */
+struct planet_span {
+	uint32_t *row_t; /* Top screen row */
+	uint32_t *row_b; /* Bottom screen row */
+	const uint32_t *texture_t; /* Top texture row */
+	const uint32_t *texture_b; /* Bottom texture row */
+	const struct planet_pixel *pixels; /* Scaled cache entries for the span */
+	bool lighting; /* Whether to apply lighting */
+	int x; /* First pixel of the span */
+	int diameter; /* Planet diameter - 1, to reflect x to the right */
+	int count; /* Number of pixels in the span */
+	int texture_w; /* Texture width, to wrap offsets at */
+	int rot; /* Texture offset for the left half */
+	int rot2; /* Texture offset for the right half */
+};
+
+/*
+ * Vectorised planet render kernel.
+ *
+ * Gives identical results to the scalar planet_update_render_flat and
+ * planet_update_render_lighting pixel loops.  Renders as many of the
+ * span's pixels as it can in whole vectors, from the start of the span,
+ * and returns the number of pixels it handled.  The caller must render
+ * any remaining pixels with the scalar code.  If the CPU has no suitable
+ * instructions, zero is returned.
+ */
+int planet_simd_render_span(const struct planet_span *span);
+
+/* Blend a 2x2 grid of texels into one, for the next mip level.  Each pair
+ * of channels is summed in one go, as they can't overflow into each other.
+ * marker indicates top left texel in grid, span is the row span of the
+ * larger texture. */
+static inline uint32_t planet_make_mip_px(const uint32_t *marker, int span)
+{
+	const uint32_t mask = 0x00ff00ff;
+	uint32_t lo, hi;
+
+	lo = (marker[0] & mask) + (marker[1] & mask) +
+			(marker[span] & mask) + (marker[span + 1] & mask);
+	hi = ((marker[0] >> 8) & mask) + ((marker[1] >> 8) & mask) +
+			((marker[span] >> 8) & mask) +
+			((marker[span + 1] >> 8) & mask);
+
+	return ((lo >> 2) & mask) | ((hi << 6) & ~mask);
+}
+
+/*
+ * Vectorised mip level downsampling.
+ *
+ * Each output texel has the floor of the mean of each channel of a 2x2
+ * grid of texels, as the scalar planet_make_mip_px.  Both return the
+ * number of output texels they handled from the start of the row, and
+ * zero if the CPU has no suitable instructions.
+ *
+ * planet_simd_mip_row makes up to count texels from rows t and b of the
+ * level above, reading twice as many texels from each.
+ *
+ * planet_simd_mip_rows_4x makes two levels in one pass over four rows of
+ * a texture, in: the two rows of the next level in mid, and up to count
+ * texels of the row of the level after that in out.  For n texels of out,
+ * 2n texels of each mid row are written and 4n texels of each in row are
+ * read.  The result is the same as making the levels one after the other.
+ */
+int planet_simd_mip_row(const uint32_t *t, const uint32_t *b,
+		uint32_t *out, int count);
+int planet_simd_mip_rows_4x(const uint32_t *const in[4],
+		uint32_t *const mid[2], uint32_t *out, int count);
+
+#endif
@@ -3,6 +3,7 @@
 #include <math.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <SDL/SDL.h>
 #include <SDL/SDL_image.h>
@@ -10,9 +11,15 @@
 #include "fixed-point.h"
 #include "colours.h"
 #include "planet.h"
+#include "planet-simd.h"
+#include "planet-cache.h"
 #include "cellular-texture.h"
 #include "texture/player.h"
 #include "texture/earth-like.h"
+#include "../noise/noise.h"
+#include "../noise/noise-simd.h"
+#include "thread-pool.h"
+#include "trig.h"
 #include "types.h"
 
 
@@ -30,56 +37,112 @@
 
 #define ROT_STEP 2048
 
+/* Mip levels.  The small render uses a quarter size texture, and there are
+ * further levels down to a minimum diameter */
+#define PLANET_MIPS_MAX 12
+#define PLANET_MIP_SMALL 2
+#define PLANET_MIP_MIN_SIZE 8
 
-struct planet_internals {
+/* Lighting direction, from the left / front.  (8-15-17 triangle.) */
+#define LIGHT_X (-8.0 / 17.0)
+#define LIGHT_Z (15.0 / 17.0)
+
+/* Scale from terrain slope, in noise units per planet radius, to bump */
+#define BUMP_SHIFT 26
+
+/* Texture generation works on bands of rows, in parallel.  Every texel
+ * depends only on its position and the seeds, so the texture is the same
+ * whatever the number of threads */
+#define PLANET_BAND_ROWS 8
+
+/* Textures at least this size are generated a band of columns at a time, as
+ * they rotate into view, generating a PLANET_LAZY_PREFETCH'th of the width
+ * ahead of what's visible */
+#define PLANET_LAZY_MIN_SIZE 1024
+#define PLANET_LAZY_BANDS 256
+#define PLANET_LAZY_PREFETCH 16
+
+
+/* Terrain slope at a texel, along texture x and y */
+struct planet_bump {
+	int8_t u;
+	int8_t v;
+};
+
+/* Circle rendering caches.  These only depend on the diameter, so planets of
+ * the same size share them. */
+struct planet_geometry {
 	int size; /* Planet diameter */
+	int refs; /* Number of users */
+	int px_count; /* Number of pixels in a quarter of the circle */
 	int *line_lengths; /* Cache of circle quadrant line lengths */
-	int *angles; /* Cache of circle quadrant pixel texturing angles */
-	Uint8 *lighting; /* Cache of circle half lighting fractions */
+	struct planet_pixel *pixels; /* Cache of quadrant pixel angles, lighting */
+	int8_t *light_tangent; /* Cache of circle half light along texture x, y */
+	struct planet_geometry *next;
+};
+
 
+/* A level of the texture mip chain.  Each is half the diameter of the one
+ * before. */
+struct planet_mip {
 	int texture_w; /* Width of texture */
 	int texture_r; /* Row span of texture */
 	int texture_h; /* Height of texture */
 	uint32_t *texture; /* Data matches planet render surface colour format */
 	int texture_w2; /* Half width of texture */
+	struct planet_bump *bump; /* Texel slopes, same layout as texture, or NULL */
+};
+
+
+/* Rendering at a given diameter */
+struct planet_internals {
+	int size; /* Planet diameter */
+	struct planet_geometry *geometry; /* Shared, read only */
+	const struct planet_mip *mip; /* Texture to render from */
+	struct planet_pixel *pixels; /* Geometry's pixels, scaled to texture */
+
+	/* Last render, to skip redraws that would not change any pixels */
+	const void *drawn_pixels; /* Screen pixels rendered to, or NULL */
+	int drawn_x;
+	int drawn_y;
+	int drawn_rot; /* Left and right side texture offsets */
+	int drawn_rot2;
 };
 
 
 struct planet {
-	struct planet_internals big;
-	struct planet_internals small;
+	struct planet_mip mip[PLANET_MIPS_MAX];
+	int mips; /* Number of mip levels */
+
+	struct planet_internals big; /* Full size */
+	struct planet_internals small; /* Quarter size, for the scaled view */
+	struct planet_internals view; /* Any other size */
+
+	struct planet_lazy *lazy; /* Generation state, while texture is partial */
 
 	int size; /* Planet diameter */
 	int rotation; /* Fixed point.  2 * FIX_MULTIPLE is a full circle */
+	bool lighting; /* Whether to render with lighting */
 
 	void (*update_render)(struct planet_internals *p, SDL_Surface *screen,
-			int screen_x, int screen_y, int rotation);
+			int screen_x, int screen_y, int rot, int rot2);
 };
 
 
 
 
-static int arc_cosine_table[LUT_MAX];
-
-/*
- * Initialise the arc_cosine lookup table.
- *
- * Only holds values from acos(0) to acos(1)
- */
-static void arc_cosine_lut_init()
-{
-	double arg, res;
-	int i;
+static const int *arc_cosine_table;
 
-	for (i = 0; i < LUT_MAX; i++) {
-		arg = i / (double)(LUT_MAX);
-		res = acos(arg);
+static struct planet_geometry *planet_geometries;
 
-		/* Factor out pi, and store as fixed point */
-		arc_cosine_table[i] = (res / M_PI) * FIX_MULTIPLE;
-	}
-}
+static struct thread_pool *planet_threads;
 
+static void planet_lazy_free(struct planet *planet);
+static void planet_lazy_ensure_view(struct planet *planet,
+		const struct planet_internals *p, const SDL_Surface *screen,
+		int rot, int rot2);
+static void planet_lazy_ensure_level(struct planet *planet,
+		const struct planet_internals *p, const SDL_Surface *screen);
 
 /*
  * Look up the arc cosine of value, x (between 0 and 1 are valid)
@@ -96,37 +159,93 @@ static inline int arc_cosine(int x)
 }
 
 
+/*
+ * Get the light direction in the texture's x and y directions at a point on
+ * the visible surface, for bump mapping.
+ *
+ * \param t         Returns light along texture x and y, scaled to +/- 127
+ * \param lighting  Lighting fraction at the point
+ * \param nx        Surface normal x component
+ * \param ny        Surface normal y component
+ * \param nz        Surface normal z component
+ *
+ * Texture x increases along E = (nz, 0, -nx) / e, and texture y along
+ * S = (-ny * nx, e * e, -ny * nz) / e, where e = sqrt(nx * nx + nz * nz).
+ * A slope rising towards the light tilts the normal towards it, so the
+ * values are negated.
+ */
+static void planet_light_tangent(int8_t t[2], Uint8 lighting,
+		double nx, double ny, double nz)
+{
+	double e = sqrt(nx * nx + nz * nz);
+
+	if (e == 0 || lighting == 0) {
+		/* At a pole there's no texture x direction, and unlit
+		 * parts stay unlit */
+		t[0] = 0;
+		t[1] = 0;
+		return;
+	}
+
+	t[0] = -127 * (nz * LIGHT_X - nx * LIGHT_Z) / e;
+	t[1] = -127 * (-ny * nx * LIGHT_X - ny * nz * LIGHT_Z) / e;
+}
+
+
 void planet_init(void)
 {
-	arc_cosine_lut_init();
+	/* Only holds values from acos(0) to acos(1).  If it can't be
+	 * allocated, no planets can be created */
+	arc_cosine_table = trig_get_arc_cosine(LUT_MAX, FIX_SHIFT);
+	noise_simd_init();
+
+	/* Texture generation runs serially if there's no pool */
+	if (planet_threads == NULL &&
+			!thread_pool_create(&planet_threads, peltar_opts.threads))
+		planet_threads = NULL;
+}
+
+
+static void planet_geometry_free(struct planet_geometry *g)
+{
+	if (g->line_lengths != NULL)
+		free(g->line_lengths);
+
+	if (g->pixels != NULL)
+		free(g->pixels);
+
+	if (g->light_tangent != NULL)
+		free(g->light_tangent);
+
+	free(g);
 }
 
 
-static bool planet_create_details(struct planet_internals *p, int size)
+/* Build the circle rendering caches for a planet diameter */
+static struct planet_geometry *planet_geometry_create(int size)
 {
+	struct planet_geometry *g;
 	int x, y, y2;
 	int line_start, line_length;
 	int px_count;
 	int i;
 	int adjacent, angle;
 
-	/* Texture dimensions */
-	p->texture_h = size;
-	p->texture_w = (size * M_PI) + 0.5;
-	p->texture_r =  + 0.5;
-	p->texture_r = p->texture_w + (p->texture_w + 3) / 4;
-	p->texture_w2 = p->texture_w / 2;
+	if (arc_cosine_table == NULL)
+		return NULL;
 
-	/* Allocate memory for texture */
-	p->texture = malloc(sizeof(uint32_t) * p->texture_h * p->texture_r);
-	if (p->texture == NULL) {
-		return false;
-	}
+	g = malloc(sizeof(*g));
+	if (g == NULL)
+		return NULL;
+
+	g->line_lengths = NULL;
+	g->pixels = NULL;
+	g->light_tangent = NULL;
 
 	/* Allocate memory for line_lengths cache */
-	p->line_lengths = malloc(sizeof(int) * size / 2);
-	if (p->line_lengths == NULL) {
-		return false;
+	g->line_lengths = malloc(sizeof(int) * size / 2);
+	if (g->line_lengths == NULL) {
+		goto fail;
 	}
 
 	/* Loop through top left quarter of circle and find length of row of
@@ -136,23 +255,24 @@ static bool planet_create_details(struct planet_internals *p, int size)
 	for (y = 0; y < size / 2; y++) {
 		y2 = (y - size / 2) * (y - size / 2);
 
-		p->line_lengths[y] = 0;
+		g->line_lengths[y] = 0;
 		/* Find length and start of row of pixels that are inside
 		 * the top left quarter of the circle. */
 		for (x = 0; x < size / 2; x++) {
 			if ((x - size / 2) * (x - size / 2) + y2 <=
 					(size / 2) * (size / 2)) {
 				/* Pixel is in circle */
-				p->line_lengths[y] += 1;
+				g->line_lengths[y] += 1;
 			}
 		}
-		px_count += p->line_lengths[y];
+		px_count += g->line_lengths[y];
 	}
+	g->px_count = px_count;
 
-	/* Allocate memory for angle cache */
-	p->angles = malloc(sizeof(int) * px_count);
-	if (p->angles == NULL) {
-		return false;
+	/* Allocate memory for angle and lighting cache */
+	g->pixels = malloc(sizeof(*g->pixels) * px_count);
+	if (g->pixels == NULL) {
+		goto fail;
 	}
 
 	/* Populate the angle cache */
@@ -161,7 +281,7 @@ static bool planet_create_details(struct planet_internals *p, int size)
 
 		/* Look up the number of pixels that are within the quarter
 		 * circle on this row. */
-		line_length = p->line_lengths[y];
+		line_length = g->line_lengths[y];
 
 		if (line_length == 0)
 			/* Nothing to render */
@@ -185,25 +305,24 @@ static bool planet_create_details(struct planet_internals *p, int size)
 					(FIX_MULTIPLE / 2)) / line_length) >>
 					CONV_FIX_TO_LUT);
 
-			/* Cache the angle */
-			p->angles[i] = angle;
+			g->pixels[i].angle = angle;
 			i++;
 		}
 	}
 
-	/* Allocate memory for lighting cache */
-	p->lighting = malloc(sizeof(*p->lighting) * 2 * px_count);
-	if (p->lighting == NULL) {
-		return false;
+	/* Allocate memory for light direction cache */
+	g->light_tangent = malloc(sizeof(*g->light_tangent) * 4 * px_count);
+	if (g->light_tangent == NULL) {
+		goto fail;
 	}
 
 	int r = size / 2;
-	/* Populate the angle cache */
+	/* Populate the lighting cache, counting circle halves */
 	i = 0;
 	for (y = 0; y < size / 2; y++) {
 		/* Look up the number of pixels that are within the quarter
 		 * circle on this row. */
-		line_length = p->line_lengths[y];
+		line_length = g->line_lengths[y];
 
 		if (line_length == 0)
 			/* Nothing to render */
@@ -214,6 +333,7 @@ static bool planet_create_details(struct planet_internals *p, int size)
 
 		/* Cache lighting values for half circle */
 		for (x = line_start; x < r; x++) {
+			struct planet_pixel *px = &g->pixels[i / 2];
 			double lighting;
 			double z = sqrt(fabs((r + 0.5) * (r + 0.5) -
 					(r - x) * (r - x) -
@@ -241,12 +361,18 @@ static bool planet_create_details(struct planet_internals *p, int size)
 					(z  / (r + 0.5)) * (15.0 / 17.0);
 
 			if (lighting < 0)
-				p->lighting[i] = 0;
+				px->lighting[0] = 0;
 			else if (lighting <= 1)
-				p->lighting[i] = 255 * lighting;
+				px->lighting[0] = 255 * lighting;
 			else
 				printf("lighting: %f\t z: %f\n", lighting, z);
 
+			planet_light_tangent(&g->light_tangent[i * 2],
+					px->lighting[0],
+					(x - r) / (r + 0.5),
+					(y - r) / (r + 0.5),
+					z / (r + 0.5));
+
 			i++;
 
 			/* Caching lighting for top half of circle.
@@ -260,17 +386,170 @@ static bool planet_create_details(struct planet_internals *p, int size)
 					(z  / (r + 0.5)) * (15.0 / 17.0);
 
 			if (lighting < 0)
-				p->lighting[i] = 0;
+				px->lighting[1] = 0;
 			else if (lighting <= 1)
-				p->lighting[i] = 255 * lighting;
+				px->lighting[1] = 255 * lighting;
 			else
 				printf("lighting: %f\t z: %f\n", lighting, z);
+
+			planet_light_tangent(&g->light_tangent[i * 2],
+					px->lighting[1],
+					(r - x) / (r + 0.5),
+					(y - r) / (r + 0.5),
+					z / (r + 0.5));
 			i++;
 		}
 	}
 
-	/* Initialise values */
+	g->size = size;
+	g->refs = 0;
+
+	return g;
+
+fail:
+	planet_geometry_free(g);
+	return NULL;
+}
+
+
+/*
+ * Get the shared circle rendering caches for a planet diameter, creating
+ * them if no other planet of that size exists.  Release with
+ * planet_geometry_put().
+ */
+static struct planet_geometry *planet_geometry_get(int size)
+{
+	struct planet_geometry *g;
+
+	for (g = planet_geometries; g != NULL; g = g->next) {
+		if (g->size == size)
+			break;
+	}
+
+	if (g == NULL) {
+		g = planet_geometry_create(size);
+		if (g == NULL)
+			return NULL;
+
+		g->next = planet_geometries;
+		planet_geometries = g;
+	}
+
+	g->refs++;
+
+	return g;
+}
+
+
+static void planet_geometry_put(struct planet_geometry *g)
+{
+	struct planet_geometry **link;
+
+	if (--g->refs > 0)
+		return;
+
+	for (link = &planet_geometries; *link != g; link = &(*link)->next)
+		;
+	*link = g->next;
+
+	planet_geometry_free(g);
+}
+
+
+static bool planet_create_mip(struct planet_mip *p, int size)
+{
+	/* Texture dimensions */
+	p->texture_h = size;
+	p->texture_w = (size * M_PI) + 0.5;
+#ifdef PLANET_TEXTURE_MODULO
+	p->texture_r = p->texture_w;
+#else
+	p->texture_r = p->texture_w + (p->texture_w + 3) / 4;
+#endif
+	p->texture_w2 = p->texture_w / 2;
+
+	/* Allocate memory for texture */
+	p->texture = malloc(sizeof(uint32_t) * p->texture_h * p->texture_r);
+	if (p->texture == NULL) {
+		return false;
+	}
+
+	return true;
+}
+
+
+static void planet_free_internals(struct planet_internals *p)
+{
+	if (p->geometry != NULL)
+		planet_geometry_put(p->geometry);
+
+	if (p->pixels != NULL)
+		free(p->pixels);
+}
+
+
+/*
+ * Scale a pixel cache entry's angle to a texture with half width texture_w2.
+ *
+ * Renders only use whole texel rotations, so the left side's texel offset is
+ * the scaled angle rounded down, and the right side's, where it's reflected,
+ * is the scaled angle rounded up.  Both are kept in 16 bits as twice the
+ * rounded down offset, plus one if that dropped a fraction.  (The angles are
+ * at most a quarter turn, so this holds for textures up to 128K wide.)
+ */
+static inline uint16_t planet_scale_angle(uint16_t angle, int texture_w2)
+{
+	int offset = angle * texture_w2;
+
+	return (offset >> FIX_SHIFT) * 2 + ((offset & FIX_MASK) != 0);
+}
+
+/* Get the left and right side texel offsets for a scaled angle */
+static inline int planet_angle_left(int angle)
+{
+	return angle >> 1;
+}
+
+static inline int planet_angle_right(int angle)
+{
+	return (angle + 1) >> 1;
+}
+
+/* Set up rendering at a diameter, with a mip level's texture */
+static bool planet_set_internals(struct planet_internals *p,
+		const struct planet_mip *mip, int size)
+{
+	struct planet_geometry *geometry;
+	struct planet_pixel *pixels;
+	int i;
+
+	/* Get the new geometry before releasing the old, in case the sizes
+	 * share it */
+	geometry = planet_geometry_get(size);
+	if (geometry == NULL) {
+		return false;
+	}
+
+	/* Scale the angles to the texture once, rather than every render */
+	pixels = malloc(sizeof(*pixels) * geometry->px_count);
+	if (pixels == NULL) {
+		planet_geometry_put(geometry);
+		return false;
+	}
+
+	for (i = 0; i < geometry->px_count; i++) {
+		pixels[i] = geometry->pixels[i];
+		pixels[i].angle = planet_scale_angle(pixels[i].angle,
+				mip->texture_w2);
+	}
+
+	planet_free_internals(p);
+
+	p->geometry = geometry;
+	p->pixels = pixels;
+	p->mip = mip;
 	p->size = size;
+	p->drawn_pixels = NULL;
 
 	return true;
 }
@@ -278,31 +557,57 @@ static bool planet_create_details(struct planet_internals *p, int size)
 
 bool planet_create(struct planet **p, int size)
 {
+	int i;
+
 	*p = malloc(sizeof(struct planet));
 	if (*p == NULL)
 		return false;
 
 	size &= ~0x7;
 
-	(*p)->big.texture = NULL;
-	(*p)->big.lighting = NULL;
-	(*p)->big.line_lengths = NULL;
-	(*p)->big.angles = NULL;
+	for (i = 0; i < PLANET_MIPS_MAX; i++) {
+		(*p)->mip[i].texture = NULL;
+		(*p)->mip[i].bump = NULL;
+	}
+	(*p)->mips = 0;
+	(*p)->lazy = NULL;
 
-	(*p)->small.texture = NULL;
-	(*p)->small.lighting = NULL;
-	(*p)->small.line_lengths = NULL;
-	(*p)->small.angles = NULL;
+	(*p)->big.geometry = NULL;
+	(*p)->small.geometry = NULL;
+	(*p)->view.geometry = NULL;
+	(*p)->big.pixels = NULL;
+	(*p)->small.pixels = NULL;
+	(*p)->view.pixels = NULL;
 
 	(*p)->rotation = 1 << FIX_SHIFT;
 	(*p)->size = size;
 
-	if (!planet_create_details(&((*p)->big), size)) {
+	for (i = 0; i < PLANET_MIPS_MAX; i++) {
+		int mip_size = (size >> i) & ~0x1;
+
+		if (i > PLANET_MIP_SMALL && mip_size < PLANET_MIP_MIN_SIZE)
+			break;
+
+		if (!planet_create_mip(&(*p)->mip[i], mip_size)) {
+			planet_free(*p);
+			return false;
+		}
+		(*p)->mips++;
+	}
+
+	if (!planet_set_internals(&(*p)->big, &(*p)->mip[0], size)) {
+		planet_free(*p);
+		return false;
+	}
+
+	if (!planet_set_internals(&(*p)->small,
+			&(*p)->mip[PLANET_MIP_SMALL], size / 4)) {
 		planet_free(*p);
 		return false;
 	}
 
-	if (!planet_create_details(&((*p)->small), size / 4)) {
+	/* Other sizes are rendered by changing the view's size */
+	if (!planet_set_internals(&(*p)->view, &(*p)->mip[0], size)) {
 		planet_free(*p);
 		return false;
 	}
@@ -313,33 +618,59 @@ bool planet_create(struct planet **p, int size)
 }
 
 
-static void planet_free_internals(struct planet_internals *p)
+static void planet_free_mip(struct planet_mip *p)
 {
 	if (p->texture != NULL)
 		free(p->texture);
 
-	if (p->line_lengths != NULL)
-		free(p->line_lengths);
-
-	if (p->angles != NULL)
-		free(p->angles);
-
-	if (p->lighting != NULL)
-		free(p->lighting);
+	if (p->bump != NULL)
+		free(p->bump);
 }
 
 
 void planet_free(struct planet *p)
 {
+	int i;
+
 	assert(p != NULL);
 
+	planet_lazy_free(p);
+
+	for (i = 0; i < p->mips; i++)
+		planet_free_mip(&p->mip[i]);
+
 	planet_free_internals(&p->big);
 	planet_free_internals(&p->small);
+	planet_free_internals(&p->view);
 
 	free(p);
 }
 
 
+/* Get the texture row for a row of the render, which may be a different size
+ * to the texture */
+static inline int planet_texture_row(const struct planet_internals *p, int y)
+{
+	return y * p->mip->texture_h / p->size;
+}
+
+/* Get the texel in a texture row at an offset.  Offsets run up to a quarter
+ * turn past the texture width, where the row span has a copy of the start of
+ * the row, unless textures are built without it */
+static inline int planet_texture_offset(const struct planet_mip *mip,
+		int offset)
+{
+#ifdef PLANET_TEXTURE_MODULO
+	if (offset >= mip->texture_w)
+		offset -= mip->texture_w;
+#else
+	(void)(mip);
+#endif
+
+	return offset;
+}
+
+
 static inline void planet_set_pixel_flat(uint32_t *restrict pixel,
 		const uint32_t *restrict texture)
 {
@@ -349,29 +680,32 @@ static inline void planet_set_pixel_flat(uint32_t *restrict pixel,
 
 
 static void planet_update_render_flat(struct planet_internals *p,
-		SDL_Surface *screen, int screen_x, int screen_y, int rotation)
+		SDL_Surface *screen, int screen_x, int screen_y,
+		int rot, int rot2)
 {
 	const int radius = p->size / 2;
 	const int diameter = p->size - 1;
+	const struct planet_mip *mip = p->mip;
 	int x, y;
 	int line_length;
 	int offset;
+	int texture_y;
 	uint32_t *restrict row_offset_t = (uint32_t*)screen->pixels +
 			screen_y * screen->pitch / peltar_opts.screen_bpp +
 			screen_x;
 	uint32_t *restrict row_offset_b = row_offset_t +
 			diameter * screen->pitch / peltar_opts.screen_bpp;
-	const uint32_t *restrict texture_row_offset_t = p->texture;
-	const uint32_t *restrict texture_row_offset_b = p->texture +
-			(p->texture_h - 1) * p->texture_r;
-	const int *restrict angle_cache = p->angles;
-	int angle, rot, rot2;
-
-	rot = rotation;
-	rot2 = rotation + FIX_MULTIPLE;
-	if (rot2 >= FIX_MULTIPLE * 5 / 2) {
-		rot2 -= 2 << FIX_SHIFT;
-	}
+	const uint32_t *restrict texture_row_offset_t;
+	const uint32_t *restrict texture_row_offset_b;
+	const struct planet_pixel *restrict pixel_cache = p->pixels;
+	struct planet_span span;
+	int angle;
+	int done;
+
+	span.diameter = diameter;
+	span.texture_w = mip->texture_w;
+	span.rot = rot;
+	span.rot2 = rot2;
 
 	/* Loop through top left quarter of circle, and render symmetrically
 	 * reflected points on each iteration. */
@@ -379,7 +713,7 @@ static void planet_update_render_flat(struct planet_internals *p,
 
 		/* Look up the number of pixels that are within the quarter
 		 * circle on this row. */
-		line_length = p->line_lengths[y];
+		line_length = p->geometry->line_lengths[y];
 
 		if (line_length == 0)
 			/* Nothing to render */
@@ -390,23 +724,41 @@ static void planet_update_render_flat(struct planet_internals *p,
 		row_offset_b -= screen->pitch / peltar_opts.screen_bpp;
 
 		/* Set offsets to texture pixel data for row */
-		texture_row_offset_t += p->texture_r;
-		texture_row_offset_b -= p->texture_r;
-
-		/* Render a row of points in each quarter of the circle */
-		for (x = radius - line_length; x < radius; x++) {
+		texture_y = planet_texture_row(p, y);
+		texture_row_offset_t = mip->texture +
+				texture_y * mip->texture_r;
+		texture_row_offset_b = mip->texture +
+				(mip->texture_h - 1 - texture_y) * mip->texture_r;
+
+		/* Render as much of the row as possible with vector code */
+		span.row_t = row_offset_t;
+		span.row_b = row_offset_b;
+		span.texture_t = texture_row_offset_t;
+		span.texture_b = texture_row_offset_b;
+		span.pixels = pixel_cache;
+		span.lighting = false;
+		span.x = radius - line_length;
+		span.count = line_length;
+		done = planet_simd_render_span(&span);
+		pixel_cache += done;
+
+		/* Render the rest of the row of points in each quarter of the
+		 * circle */
+		for (x = span.x + done; x < radius; x++) {
 			int right;
 
 			/* Get cached angle subtended by adjacent/hypotenuse, or
-			 * [position along line]/[line length]. */
-			angle = *angle_cache++;
+			 * [position along line]/[line length], scaled to
+			 * texture offset. */
+			angle = pixel_cache->angle;
 
 			/* Apply planet's current rotation (between 0 and 2) to
 			 * angle (which is between 0 and 0.5), and wrap back to
 			 * range 0 to 2 */
 
 			/* Get offset into texture, for current angle. */
-			offset = (p->texture_w2 * (rot + angle)) >> FIX_SHIFT;
+			offset = planet_texture_offset(mip,
+					rot + planet_angle_left(angle));
 
 			/* Set pixel colour from texture, for top and bottom
 			 * rows */
@@ -420,7 +772,8 @@ static void planet_update_render_flat(struct planet_internals *p,
 			 * exploiting cosine symmetry.  (To map from first
 			 * quadrant to second quadrant.) */
 
-			offset = (p->texture_w2 * (rot2 - angle)) >> FIX_SHIFT;
+			offset = planet_texture_offset(mip,
+					rot2 - planet_angle_right(angle));
 
 			/* Get offset to pixels on right hand side of circle */
 			right = diameter - x;
@@ -429,32 +782,122 @@ static void planet_update_render_flat(struct planet_internals *p,
 					texture_row_offset_t + offset);
 			planet_set_pixel_flat(row_offset_b + right,
 					texture_row_offset_b + offset);
+
+			pixel_cache++;
 		}
 	}
 }
 
 
-void planet_update_render(struct planet *p, SDL_Surface *screen,
+/* Get the left and right side texture offsets for a rotation.  Rounded to
+ * whole texels, so renders only change when the rotation moves the texture
+ * by at least one texel.  The right side's is rounded up,
+ * as its smallest offset, less a quarter turn, mustn't go before the start
+ * of the texture. */
+static inline void planet_get_rotation(const struct planet_internals *p,
+		int rotation, int *rot, int *rot2)
+{
+	*rot = rotation;
+	*rot2 = rotation + FIX_MULTIPLE;
+	if (*rot2 >= FIX_MULTIPLE * 5 / 2) {
+		*rot2 -= 2 << FIX_SHIFT;
+	}
+
+	*rot = (*rot * p->mip->texture_w2) >> FIX_SHIFT;
+	*rot2 = (*rot2 * p->mip->texture_w2 + FIX_MASK) >> FIX_SHIFT;
+}
+
+
+static void planet_update_render_internal(struct planet *planet,
+		struct planet_internals *p, SDL_Surface *screen,
 		int screen_x, int screen_y)
 {
-	p->update_render(&p->big, screen, screen_x, screen_y, p->rotation);
+	int rot, rot2;
+
+	planet_get_rotation(p, planet->rotation, &rot, &rot2);
+
+	/* Every row is shifted by the same whole number of texels, so if
+	 * the shifts haven't changed since the last render here, the pixels
+	 * on screen are already correct. */
+	if (p->drawn_pixels != screen->pixels ||
+			p->drawn_x != screen_x || p->drawn_y != screen_y ||
+			p->drawn_rot != rot || p->drawn_rot2 != rot2) {
+		if (planet->lazy != NULL)
+			planet_lazy_ensure_view(planet, p, screen, rot, rot2);
+
+		planet->update_render(p, screen, screen_x, screen_y,
+				rot, rot2);
+
+		p->drawn_pixels = screen->pixels;
+		p->drawn_x = screen_x;
+		p->drawn_y = screen_y;
+		p->drawn_rot = rot;
+		p->drawn_rot2 = rot2;
+	}
 
 	/* Update rotation for next call */
-	p->rotation += (1 << FIX_SHIFT) / ROT_STEP;
-	if (p->rotation > (2 << FIX_SHIFT))
-		p->rotation -= (2 << FIX_SHIFT);
+	planet->rotation += (1 << FIX_SHIFT) / ROT_STEP;
+	if (planet->rotation > (2 << FIX_SHIFT))
+		planet->rotation -= (2 << FIX_SHIFT);
+}
+
+
+void planet_update_render(struct planet *p, SDL_Surface *screen,
+		int screen_x, int screen_y)
+{
+	planet_update_render_internal(p, &p->big, screen, screen_x, screen_y);
 }
 
 
 void planet_update_render_scaled(struct planet *p, SDL_Surface *screen,
 		int screen_x, int screen_y)
 {
-	p->update_render(&p->small, screen, screen_x, screen_y, p->rotation);
+	planet_update_render_internal(p, &p->small, screen, screen_x, screen_y);
+}
 
-	/* Update rotation for next call */
-	p->rotation += (1 << FIX_SHIFT) / ROT_STEP;
-	if (p->rotation > (2 << FIX_SHIFT))
-		p->rotation -= (2 << FIX_SHIFT);
+
+/*
+ * Render at any diameter.  Uses the smallest mip level which is at least the
+ * render size, so the texture is never shrunk by more than half.
+ *
+ * Returns false if the render geometry for a new size can't be allocated.
+ */
+bool planet_update_render_size(struct planet *p, SDL_Surface *screen,
+		int screen_x, int screen_y, int size)
+{
+	struct planet_internals *view = &p->view;
+	int i;
+
+	/* Odd sizes would leave a gap down the middle */
+	size &= ~0x1;
+	if (size <= 0)
+		return true;
+
+	if (size == p->big.size) {
+		view = &p->big;
+	} else if (size == p->small.size) {
+		view = &p->small;
+	} else if (size != view->size) {
+		for (i = p->mips - 1; i > 0; i--) {
+			if (p->mip[i].texture_h >= size)
+				break;
+		}
+
+		if (!planet_set_internals(view, &p->mip[i], size))
+			return false;
+	}
+
+	planet_update_render_internal(p, view, screen, screen_x, screen_y);
+
+	return true;
+}
+
+
+void planet_invalidate_render(struct planet *p)
+{
+	p->big.drawn_pixels = NULL;
+	p->small.drawn_pixels = NULL;
+	p->view.drawn_pixels = NULL;
 }
 
 static inline void planet_set_pixel_lighting(uint32_t *restrict pixel,
@@ -466,30 +909,32 @@ static inline void planet_set_pixel_lighting(uint32_t *restrict pixel,
 }
 
 static void planet_update_render_lighting(struct planet_internals *p,
-		SDL_Surface *screen, int screen_x, int screen_y, int rotation)
+		SDL_Surface *screen, int screen_x, int screen_y,
+		int rot, int rot2)
 {
 	const int radius = p->size / 2;
 	const int diameter = p->size - 1;
+	const struct planet_mip *mip = p->mip;
 	int x, y;
 	int line_length;
 	int offset;
+	int texture_y;
 	uint32_t *restrict row_offset_t = (uint32_t*)screen->pixels +
 			screen_y * screen->pitch / peltar_opts.screen_bpp +
 			screen_x;
 	uint32_t *restrict row_offset_b = row_offset_t +
 			diameter * screen->pitch / peltar_opts.screen_bpp;
-	const uint32_t *restrict texture_row_offset_t = p->texture;
-	const uint32_t *restrict texture_row_offset_b = p->texture +
-			(p->texture_h - 1) * p->texture_r;
-	const int *restrict angle_cache = p->angles;
-	const Uint8 *restrict l = p->lighting; /* lighting cache index */
-	int angle, rot, rot2;
-
-	rot = rotation;
-	rot2 = rotation + FIX_MULTIPLE;
-	if (rot2 >= FIX_MULTIPLE * 5 / 2) {
-		rot2 -= 2 << FIX_SHIFT;
-	}
+	const uint32_t *restrict texture_row_offset_t;
+	const uint32_t *restrict texture_row_offset_b;
+	const struct planet_pixel *restrict pixel_cache = p->pixels;
+	struct planet_span span;
+	int angle;
+	int done;
+
+	span.diameter = diameter;
+	span.texture_w = mip->texture_w;
+	span.rot = rot;
+	span.rot2 = rot2;
 
 	/* Loop through top left quarter of circle, and render symmetrically
 	 * reflected points on each iteration. */
@@ -497,7 +942,7 @@ static void planet_update_render_lighting(struct planet_internals *p,
 
 		/* Look up the number of pixels that are within the quarter
 		 * circle on this row. */
-		line_length = p->line_lengths[y];
+		line_length = p->geometry->line_lengths[y];
 
 		if (line_length == 0)
 			/* Nothing to render */
@@ -508,182 +953,680 @@ static void planet_update_render_lighting(struct planet_internals *p,
 		row_offset_b -= screen->pitch / peltar_opts.screen_bpp;
 
 		/* Set offsets to texture pixel data for row */
-		texture_row_offset_t += p->texture_r;
-		texture_row_offset_b -= p->texture_r;
-
-		/* Render a row of points in each quarter of the circle */
-		for (x = radius - line_length; x < radius; x++) {
+		texture_y = planet_texture_row(p, y);
+		texture_row_offset_t = mip->texture +
+				texture_y * mip->texture_r;
+		texture_row_offset_b = mip->texture +
+				(mip->texture_h - 1 - texture_y) * mip->texture_r;
+
+		/* Render as much of the row as possible with vector code */
+		span.row_t = row_offset_t;
+		span.row_b = row_offset_b;
+		span.texture_t = texture_row_offset_t;
+		span.texture_b = texture_row_offset_b;
+		span.pixels = pixel_cache;
+		span.lighting = true;
+		span.x = radius - line_length;
+		span.count = line_length;
+		done = planet_simd_render_span(&span);
+		pixel_cache += done;
+
+		/* Render the rest of the row of points in each quarter of the
+		 * circle */
+		for (x = span.x + done; x < radius; x++) {
 			int right;
 
 			/* Get cached angle subtended by adjacent/hypotenuse, or
-			 * [position along line]/[line length]. */
-			angle = *angle_cache++;
+			 * [position along line]/[line length], scaled to
+			 * texture offset. */
+			angle = pixel_cache->angle;
 
 			/* Apply planet's current rotation (between 0 and 2) to
 			 * angle (which is between 0 and 0.5), and wrap back to
 			 * range 0 to 2 */
 
 			/* Get offset into texture, for current angle. */
-			offset = (p->texture_w2 * (rot + angle)) >> FIX_SHIFT;
+			offset = planet_texture_offset(mip,
+					rot + planet_angle_left(angle));
 
 			/* Set pixel colour from texture, for top and bottom
 			 * rows */
 			planet_set_pixel_lighting(row_offset_t + x,
 					texture_row_offset_t + offset,
-					l);
+					&pixel_cache->lighting[0]);
 			planet_set_pixel_lighting(row_offset_b + x,
 					texture_row_offset_b + offset,
-					l++);
+					&pixel_cache->lighting[0]);
 
 			/* Do same to render the two pixels on the right side */
 			/* Angle from other half can be reused as (1 - angle),
 			 * exploiting cosine symmetry.  (To map from first
 			 * quadrant to second quadrant.) */
 
-			offset = (p->texture_w2 * (rot2 - angle)) >> FIX_SHIFT;
+			offset = planet_texture_offset(mip,
+					rot2 - planet_angle_right(angle));
 
 			/* Get offset to pixels on right hand side of circle */
 			right = diameter - x;
 
 			planet_set_pixel_lighting(row_offset_t + right,
 					texture_row_offset_t + offset,
-					l);
+					&pixel_cache->lighting[1]);
 			planet_set_pixel_lighting(row_offset_b + right,
 					texture_row_offset_b + offset,
-					l++);
+					&pixel_cache->lighting[1]);
+
+			pixel_cache++;
 		}
 	}
 }
 
 
-/* Plots the big texture */
-void planet_plot_texture_internal(struct planet_internals *p, SDL_Surface *screen,
-		int screen_x, int screen_y)
+/* Clamp a bump adjusted lighting fraction */
+static inline Uint8 planet_bump_clamp_lighting(int l)
 {
-	uint32_t *row_start = (uint32_t*)screen->pixels;
-	uint32_t *pixel;
-	int x, y;
-	int i = 0;
-
-	row_start += screen_y * screen->pitch / peltar_opts.screen_bpp +
-			screen_x;
+	/* Rarely out of range */
+	if ((unsigned)l > 255)
+		l = (l < 0) ? 0 : 255;
 
-	for (y = 0; y < p->texture_h; y++) {
-		pixel = row_start;
-		for (x = 0; x < p->texture_w; x++) {
-			*pixel++ = p->texture[i++];
-		}
-		row_start += screen->pitch / peltar_opts.screen_bpp;
-		i += p->texture_r - p->texture_w;
-	}
+	return l;
 }
 
-
-void planet_plot_texture(struct planet *p, SDL_Surface *screen,
-		int screen_x, int screen_y)
+/*
+ * Adjust a lighting fraction for the slope of the terrain at two texels;
+ * one for the top half of the circle and one for the bottom half, where
+ * texture y runs the other way relative to the light.  The light direction
+ * cache is zero where the surface is unlit, which keeps it unlit.
+ *
+ * Both dot products are found with one pair of multiplies, with the bottom
+ * one in the upper 16 bits.
+ */
+static inline void planet_bump_lighting(Uint8 lighting,
+		const struct planet_bump *restrict bump_t,
+		const struct planet_bump *restrict bump_b,
+		const int8_t *restrict tangent,
+		Uint8 *restrict lighting_t, Uint8 *restrict lighting_b)
 {
-	planet_plot_texture_internal(&p->big, screen, screen_x, screen_y);
+	int32_t u = bump_t->u + bump_b->u * 65536;
+	int32_t v = bump_t->v - bump_b->v * 65536;
+	int32_t d = u * tangent[0] + v * tangent[1];
+	int16_t d_t = d;
+
+	*lighting_t = planet_bump_clamp_lighting(lighting + (d_t >> 7));
+	*lighting_b = planet_bump_clamp_lighting(lighting +
+			(((d - d_t) / 65536) >> 7));
 }
 
-
-void planet_plot_texture_scaled(struct planet *p, SDL_Surface *screen,
-		int screen_x, int screen_y)
+static void planet_update_render_bump(struct planet_internals *p,
+		SDL_Surface *screen, int screen_x, int screen_y,
+		int rot, int rot2)
 {
-	planet_plot_texture_internal(&p->small, screen, screen_x, screen_y);
-}
+	const int radius = p->size / 2;
+	const int diameter = p->size - 1;
+	const struct planet_mip *mip = p->mip;
+	const int texture_r = mip->texture_r;
+	const int stride = screen->pitch / peltar_opts.screen_bpp;
+	int x, y;
+	int line_length;
+	int offset;
+	int texture_y;
+	uint32_t *restrict row_offset_t = (uint32_t*)screen->pixels +
+			screen_y * screen->pitch / peltar_opts.screen_bpp +
+			screen_x;
+	uint32_t *restrict row_offset_b = row_offset_t +
+			diameter * screen->pitch / peltar_opts.screen_bpp;
+	const uint32_t *restrict texture_row_offset_t;
+	const uint32_t *restrict texture_row_offset_b;
+	const struct planet_bump *restrict bump_row_offset_t;
+	const struct planet_bump *restrict bump_row_offset_b;
+	const struct planet_pixel *restrict pixel_cache = p->pixels;
+	/* light direction index */
+	const int8_t *restrict t = p->geometry->light_tangent;
+	int angle;
+	Uint8 lighting_t, lighting_b;
 
+	/* Loop through top left quarter of circle, and render symmetrically
+	 * reflected points on each iteration. */
+	for (y = 0; y < radius; y++) {
 
-/* Simple smooth scaling blends the values from a 4x4 grid of pixels into one
- * value.  Call once per channel with appropriate mask.  marker indicates top
- * left pixel in grid, width is row span of large image. */
-static uint32_t planet_make_small_texture_px(const uint32_t *marker,
-		uint32_t mask, unsigned shift, int span)
-{
-	uint32_t ret = 0;
-	span -= 4;
-
-	ret += ((*marker++) & mask) >> shift;
-	ret += ((*marker++) & mask) >> shift;
-	ret += ((*marker++) & mask) >> shift;
-	ret += ((*marker++) & mask) >> shift;
-	marker += span;
-	ret += ((*marker++) & mask) >> shift;
-	ret += ((*marker++) & mask) >> shift;
-	ret += ((*marker++) & mask) >> shift;
-	ret += ((*marker++) & mask) >> shift;
-	marker += span;
-	ret += ((*marker++) & mask) >> shift;
-	ret += ((*marker++) & mask) >> shift;
-	ret += ((*marker++) & mask) >> shift;
-	ret += ((*marker++) & mask) >> shift;
-	marker += span;
-	ret += ((*marker++) & mask) >> shift;
-	ret += ((*marker++) & mask) >> shift;
-	ret += ((*marker++) & mask) >> shift;
-	ret += ((*marker++) & mask) >> shift;
-
-	ret /= 16;
-	return (ret << shift) & mask;
-}
+		/* Look up the number of pixels that are within the quarter
+		 * circle on this row. */
+		line_length = p->geometry->line_lengths[y];
 
-static void planet__texture_extend(uint32_t *restrict texture,
-		int height, int row_span, int width)
-{
-	for (int y = 0; y < height; y++) {
-		int i = y * row_span;
-		for (int x = 0; x < row_span - width; x++) {
-			texture[i + width] = texture[i];
-			i++;
+		if (line_length == 0)
+			/* Nothing to render */
+			continue;
+
+		/* Set offsets to SDL surface pixel data for row */
+		row_offset_t += stride;
+		row_offset_b -= stride;
+
+		/* Set offsets to texture pixel data for row */
+		texture_y = planet_texture_row(p, y);
+		texture_row_offset_t = mip->texture + texture_y * texture_r;
+		texture_row_offset_b = mip->texture +
+				(mip->texture_h - 1 - texture_y) * texture_r;
+		bump_row_offset_t = mip->bump + texture_y * texture_r;
+		bump_row_offset_b = mip->bump +
+				(mip->texture_h - 1 - texture_y) * texture_r;
+
+		/* Render a row of points in each quarter of the circle */
+		for (x = radius - line_length; x < radius; x++) {
+			int right;
+
+			angle = pixel_cache->angle;
+
+			/* Left side, as planet_update_render_lighting */
+			offset = planet_texture_offset(mip,
+					rot + planet_angle_left(angle));
+
+			planet_bump_lighting(pixel_cache->lighting[0],
+					bump_row_offset_t + offset,
+					bump_row_offset_b + offset, t,
+					&lighting_t, &lighting_b);
+			planet_set_pixel_lighting(row_offset_t + x,
+					texture_row_offset_t + offset,
+					&lighting_t);
+			planet_set_pixel_lighting(row_offset_b + x,
+					texture_row_offset_b + offset,
+					&lighting_b);
+			t += 2;
+
+			/* Right side */
+			offset = planet_texture_offset(mip,
+					rot2 - planet_angle_right(angle));
+
+			right = diameter - x;
+
+			planet_bump_lighting(pixel_cache->lighting[1],
+					bump_row_offset_t + offset,
+					bump_row_offset_b + offset, t,
+					&lighting_t, &lighting_b);
+			planet_set_pixel_lighting(row_offset_t + right,
+					texture_row_offset_t + offset,
+					&lighting_t);
+			planet_set_pixel_lighting(row_offset_b + right,
+					texture_row_offset_b + offset,
+					&lighting_b);
+			t += 2;
+
+			pixel_cache++;
 		}
 	}
 }
 
-static void planet_make_small_texture(struct planet *p)
+
+/* Plots the big texture */
+void planet_plot_texture_internal(struct planet_internals *p, SDL_Surface *screen,
+		int screen_x, int screen_y)
 {
-	const uint32_t *restrict big = p->big.texture;
-	uint32_t *restrict small = p->small.texture;
+	const struct planet_mip *mip = p->mip;
+	uint32_t *row_start = (uint32_t*)screen->pixels;
+	uint32_t *pixel;
 	int x, y;
-	int i, j;
-
-	i = j = 0;
-	for (y = 0; y < p->small.texture_h - 1; y++) {
-		for (x = 0; x < p->small.texture_w - 1; x++) {
-			small[i] = planet_make_small_texture_px(
-					&big[j], 0x00ff00ff, 0,
-					p->big.texture_r);
-			small[i] |= planet_make_small_texture_px(
-					&big[j], 0xff00ff00, 8,
-					p->big.texture_r);
+	int i = 0;
+
+	row_start += screen_y * screen->pitch / peltar_opts.screen_bpp +
+			screen_x;
+
+	/* May overwrite a render */
+	p->drawn_pixels = NULL;
+
+	for (y = 0; y < mip->texture_h; y++) {
+		pixel = row_start;
+		for (x = 0; x < mip->texture_w; x++) {
+			*pixel++ = mip->texture[i++];
+		}
+		row_start += screen->pitch / peltar_opts.screen_bpp;
+		i += mip->texture_r - mip->texture_w;
+	}
+}
+
+
+void planet_plot_texture(struct planet *p, SDL_Surface *screen,
+		int screen_x, int screen_y)
+{
+	if (p->lazy != NULL)
+		planet_lazy_ensure_level(p, &p->big, screen);
+
+	planet_plot_texture_internal(&p->big, screen, screen_x, screen_y);
+}
+
+
+void planet_plot_texture_scaled(struct planet *p, SDL_Surface *screen,
+		int screen_x, int screen_y)
+{
+	if (p->lazy != NULL)
+		planet_lazy_ensure_level(p, &p->small, screen);
+
+	planet_plot_texture_internal(&p->small, screen, screen_x, screen_y);
+}
+
+
+/* Copy any of columns x0 to x1 that wrap into the row span */
+static void planet__texture_extend_columns(uint32_t *restrict texture,
+		int height, int row_span, int width, int x0, int x1)
+{
+	if (x1 > row_span - width)
+		x1 = row_span - width;
+
+	for (int y = 0; y < height; y++) {
+		int i = y * row_span + x0;
+		for (int x = x0; x < x1; x++) {
+			texture[i + width] = texture[i];
+			i++;
+		}
+	}
+}
+
+static void planet__bump_extend_columns(struct planet_bump *restrict bump,
+		int height, int row_span, int width, int x0, int x1)
+{
+	if (x1 > row_span - width)
+		x1 = row_span - width;
+
+	for (int y = 0; y < height; y++) {
+		int i = y * row_span + x0;
+		for (int x = x0; x < x1; x++) {
+			bump[i + width] = bump[i];
 			i++;
-			j += 4;
 		}
-		small[i++] = big[j];
-		j = (y + 1) * p->big.texture_r * 4;
-		i += p->small.texture_r - p->small.texture_w;
 	}
+}
+
+static void planet__texture_extend(uint32_t *restrict texture,
+		int height, int row_span, int width)
+{
+	planet__texture_extend_columns(texture, height, row_span, width,
+			0, width);
+}
+
+static void planet__bump_extend(struct planet_bump *restrict bump,
+		int height, int row_span, int width)
+{
+	planet__bump_extend_columns(bump, height, row_span, width, 0, width);
+}
+
+/* Make texels x0 to x1 of a mip level's texture row from the pair of rows
+ * of the level above starting at marker, which has row span span and width
+ * width.  The last grid can wrap round to the start of the rows */
+static inline void planet_make_mip_row(uint32_t *restrict texture,
+		const uint32_t *restrict marker, int span, int width,
+		int x0, int x1)
+{
+	int end = x1 < width / 2 ? x1 : width / 2;
+	int x = x0;
+
+	if (x < end)
+		x += planet_simd_mip_row(marker + 2 * x0,
+				marker + span + 2 * x0, texture + x0, end - x0);
+
+	for (; x < end; x++)
+		texture[x] = planet_make_mip_px(marker + 2 * x, span);
+
+	for (; x < x1; x++) {
+		int a = (2 * x) % width;
+		int b = (2 * x + 1) % width;
+		const uint32_t grid[4] = {
+			marker[a], marker[b],
+			marker[span + a], marker[span + b],
+		};
+
+		texture[x] = planet_make_mip_px(grid, 2);
+	}
+}
+
+/* Make columns x0 to x1 of a mip level's texture from the level above,
+ * which is twice the size */
+static void planet_make_mip_texture(struct planet_mip *p,
+		const struct planet_mip *big, int x0, int x1)
+{
+	/* The texture wraps into the row span, so the grids for the last
+	 * column can read past the larger texture's width */
+	for (int y = 0; y < p->texture_h; y++)
+		planet_make_mip_row(p->texture + y * p->texture_r,
+				big->texture + y * 2 * big->texture_r,
+				big->texture_r, big->texture_w, x0, x1);
+
+	planet__texture_extend_columns(p->texture,
+			p->texture_h,
+			p->texture_r,
+			p->texture_w,
+			x0, x1);
+}
+
+/* Make the textures of two mip levels, mid and p, from the level above them
+ * both.  As much of p as can be is made in the same pass as mid, from 4x4
+ * grids of big.  That's only the columns whose grids in mid and big don't
+ * wrap, and the rest are made with the rest of mid after it's done */
+static void planet_make_mip_texture_4x(struct planet_mip *p,
+		struct planet_mip *mid, const struct planet_mip *big)
+{
+	int count = p->texture_w < mid->texture_w / 2 ?
+			p->texture_w : mid->texture_w / 2;
+	int done = 0;
+	int y;
+
+	if (count > big->texture_w / 4)
+		count = big->texture_w / 4;
+
+	for (y = 0; y < p->texture_h; y++) {
+		const uint32_t *in[4];
+		uint32_t *row[2];
+
+		for (int i = 0; i < 4; i++)
+			in[i] = big->texture + (4 * y + i) * big->texture_r;
+		for (int i = 0; i < 2; i++)
+			row[i] = mid->texture + (2 * y + i) * mid->texture_r;
+
+		done = planet_simd_mip_rows_4x(in, row,
+				p->texture + y * p->texture_r, count);
+
+		for (int i = 0; i < 2; i++)
+			planet_make_mip_row(row[i], in[2 * i],
+					big->texture_r, big->texture_w,
+					2 * done, mid->texture_w);
+	}
+
+	/* Rows of mid below those p is made from */
+	for (y = 2 * p->texture_h; y < mid->texture_h; y++)
+		planet_make_mip_row(mid->texture + y * mid->texture_r,
+				big->texture + y * 2 * big->texture_r,
+				big->texture_r, big->texture_w,
+				0, mid->texture_w);
+
+	planet__texture_extend(mid->texture,
+			mid->texture_h,
+			mid->texture_r,
+			mid->texture_w);
+
+	planet_make_mip_texture(p, mid, done, p->texture_w);
+	planet__texture_extend_columns(p->texture,
+			p->texture_h,
+			p->texture_r,
+			p->texture_w,
+			0, done);
+}
+
+
+/* Average the slopes of each 2x2 grid of texels, as for the texture */
+static void planet_make_mip_bump(struct planet_mip *p,
+		const struct planet_mip *big, int x0, int x1)
+{
+	const int span = big->texture_r;
+	const struct planet_bump *restrict marker;
+	struct planet_bump *restrict bump;
+	int x, y;
+
+	for (y = 0; y < p->texture_h; y++) {
+		marker = big->bump + y * 2 * span;
+		bump = p->bump + y * p->texture_r;
+
+		for (x = x0; x < x1; x++) {
+			/* The last grid can wrap round */
+			int a = 2 * x;
+			int b = (a + 1 < big->texture_w) ?
+					a + 1 : a + 1 - big->texture_w;
+
+			bump[x].u = (marker[a].u + marker[b].u +
+					marker[span + a].u +
+					marker[span + b].u) / 4;
+			bump[x].v = (marker[a].v + marker[b].v +
+					marker[span + a].v +
+					marker[span + b].v) / 4;
+		}
+	}
+
+	planet__bump_extend_columns(p->bump,
+			p->texture_h,
+			p->texture_r,
+			p->texture_w,
+			x0, x1);
+}
+
+
+/* Make the mip chain from the full size texture, and bump map if it has one.
+ * Texture levels are made two at a time where there are enough */
+static void planet_make_mips(struct planet *planet)
+{
+	for (int i = 1; i < planet->mips; i++) {
+		struct planet_mip *p = &planet->mip[i];
+
+		if (i % 2 == 1 && i + 1 < planet->mips)
+			planet_make_mip_texture_4x(&planet->mip[i + 1], p,
+					&planet->mip[i - 1]);
+		else if (i % 2 == 1)
+			planet_make_mip_texture(p, &planet->mip[i - 1],
+					0, p->texture_w);
+
+		if (planet->mip[0].bump != NULL)
+			planet_make_mip_bump(p, &planet->mip[i - 1],
+					0, p->texture_w);
+	}
+}
+
+/* Allocate bump maps for all mip levels, if they don't have them */
+static bool planet_alloc_bump(struct planet *planet)
+{
+	for (int i = 0; i < planet->mips; i++) {
+		struct planet_mip *p = &planet->mip[i];
+
+		if (p->bump != NULL)
+			continue;
+
+		p->bump = malloc(sizeof(*p->bump) *
+				p->texture_h * p->texture_r);
+		if (p->bump == NULL)
+			return false;
+	}
+
+	return true;
+}
+
+
+/* Remove bump maps, for textures which don't have them */
+static void planet_free_bump(struct planet *planet)
+{
+	for (int i = 0; i < planet->mips; i++) {
+		free(planet->mip[i].bump);
+		planet->mip[i].bump = NULL;
+	}
+}
+
+
+/* Select the render function for the lighting mode and texture */
+static void planet_set_update_render(struct planet *p)
+{
+	planet_invalidate_render(p);
+
+	if (!p->lighting)
+		p->update_render = &planet_update_render_flat;
+	else if (p->mip[0].bump != NULL)
+		p->update_render = &planet_update_render_bump;
+	else
+		p->update_render = &planet_update_render_lighting;
+}
+
+
+/* Get the source texel nearest to each of count destination texels, when
+ * resampling size texels to count.  Stepped with an exact DDA, rather than
+ * a division per texel */
+static void planet_resample_nearest(int *index, int size, int count)
+{
+	const int step = size / count;
+	const int rem = size % count;
+	int i, pos = 0, err = 0;
+
+	for (i = 0; i < count; i++) {
+		index[i] = pos;
+
+		pos += step;
+		err += rem;
+		if (err >= count) {
+			pos++;
+			err -= count;
+		}
+	}
+}
+
+/* Get the pair of source texels each of count destination texels lies
+ * between when resampling size texels to count, with texel centres lined
+ * up, and the 8 bit fraction of the way from one to the other.  Rows wrap
+ * round the planet, but columns stop at the poles */
+static void planet_resample_bilinear(int *index, int *index2, int *frac,
+		int size, int count, bool wrap)
+{
+	/* 16.16 fixed point, in int64_t as 8K wide textures use 29 bits */
+	const int64_t step = ((int64_t)size << 16) / count;
+	int64_t pos = step / 2 - (1 << 15);
+
+	for (int i = 0; i < count; i++) {
+		int a = (int)(pos >> 16);
+		int b = a + 1;
+
+		if (wrap) {
+			a = (a + size) % size;
+			b = b % size;
+		} else {
+			a = a < 0 ? 0 : a;
+			b = b >= size ? size - 1 : b;
+		}
+
+		index[i] = a;
+		index2[i] = b;
+		frac[i] = (int)((pos >> 8) & 0xff);
+
+		pos += step;
+	}
+}
+
+/* Interpolate a fraction f of the way from pixel a to b, with f out of 256.
+ * As with lighting, each pair of channels is done in one go */
+static inline uint32_t planet_lerp_px(uint32_t a, uint32_t b, uint32_t f)
+{
+	const uint32_t mask = 0x00ff00ff;
+	uint32_t lo, hi;
+
+	lo = ((a & mask) * (256 - f) + (b & mask) * f) >> 8;
+	hi = ((a >> 8) & mask) * (256 - f) + ((b >> 8) & mask) * f;
+
+	return (lo & mask) | (hi & ~mask);
+}
+
+/* State for resampling an image to mip 0's texture */
+struct planet_resample {
+	struct planet_mip *p;
+	const SDL_Surface *image; /* Already in the screen's format */
+	uint32_t pixel_mask; /* Screen format's colour channels */
+	enum planet_filter filter;
+	int *column; /* Source column for each texture column */
+	int *column2; /* Column to filter with, for bilinear */
+	int *column_f; /* Fraction of the way to column2 */
+	int *row; /* As for columns */
+	int *row2;
+	int *row_f;
+};
+
+static void planet_resample_band(void *data, unsigned band, unsigned thread)
+{
+	const struct planet_resample *r = data;
+	const struct planet_mip *p = r->p;
+	const Uint8 *pixels = r->image->pixels;
+	const int pitch = r->image->pitch;
+	int y = band * PLANET_BAND_ROWS;
+	int end = y + PLANET_BAND_ROWS;
+	int x;
+
+	(void)(thread);
+
+	if (end > p->texture_h)
+		end = p->texture_h;
+
+	for (; y < end; y++) {
+		const uint32_t *in = (const void *)(pixels + r->row[y] * pitch);
+		uint32_t *texture = p->texture + y * p->texture_r;
+
+		if (r->filter == PLANET_FILTER_NEAREST) {
+			for (x = 0; x < p->texture_w; x++)
+				texture[x] = in[r->column[x]] & r->pixel_mask;
+		} else {
+			const uint32_t *in2 = (const void *)
+					(pixels + r->row2[y] * pitch);
+
+			for (x = 0; x < p->texture_w; x++) {
+				int c = r->column[x], c2 = r->column2[x];
+				uint32_t t, b;
+
+				t = planet_lerp_px(in[c], in[c2],
+						r->column_f[x]);
+				b = planet_lerp_px(in2[c], in2[c2],
+						r->column_f[x]);
+
+				texture[x] = planet_lerp_px(t, b,
+						r->row_f[y]) & r->pixel_mask;
+			}
+		}
+	}
+}
 
-	for (x = 0; x < p->small.texture_w; x++) {
-		small[i++] = big[j];
-		j += 4;
+/* Resample an image already in the screen's format to mip 0's texture */
+static bool planet_resample_texture(struct planet_mip *p,
+		const SDL_Surface *image, uint32_t pixel_mask,
+		enum planet_filter filter)
+{
+	struct planet_resample r = {
+		.p = p,
+		.image = image,
+		.pixel_mask = pixel_mask,
+		.filter = filter,
+	};
+	unsigned bands = (p->texture_h + PLANET_BAND_ROWS - 1) /
+			PLANET_BAND_ROWS;
+
+	/* Enough for both texels and the fraction, for each column and row */
+	r.column = malloc(sizeof(int) * 3 * (p->texture_w + p->texture_h));
+	if (r.column == NULL)
+		return false;
+	r.column2 = r.column + p->texture_w;
+	r.column_f = r.column2 + p->texture_w;
+	r.row = r.column_f + p->texture_w;
+	r.row2 = r.row + p->texture_h;
+	r.row_f = r.row2 + p->texture_h;
+
+	if (filter == PLANET_FILTER_NEAREST) {
+		planet_resample_nearest(r.column, image->w, p->texture_w);
+		planet_resample_nearest(r.row, image->h, p->texture_h);
+	} else {
+		planet_resample_bilinear(r.column, r.column2, r.column_f,
+				image->w, p->texture_w, true);
+		planet_resample_bilinear(r.row, r.row2, r.row_f,
+				image->h, p->texture_h, false);
 	}
 
-	planet__texture_extend(p->small.texture,
-			p->small.texture_h,
-			p->small.texture_r,
-			p->small.texture_w);
+	thread_pool_run(planet_threads, planet_resample_band, &r, bands);
+
+	free(r.column);
+
+	return true;
 }
 
+/* Whether an image's pixels can be used as they are for a screen's */
+static bool planet_same_format(const SDL_PixelFormat *a,
+		const SDL_PixelFormat *b)
+{
+	return a->BytesPerPixel == 4 && b->BytesPerPixel == 4 &&
+			a->Rmask == b->Rmask &&
+			a->Gmask == b->Gmask &&
+			a->Bmask == b->Bmask;
+}
 
 bool planet_get_texture_from_file(struct planet *planet, const char *filename,
-		SDL_Surface *screen)
+		SDL_Surface *screen, enum planet_filter filter)
 {
-	int x, y, i;
-	int scaled_x, scaled_y;
-	SDL_Surface *sdl_texture;
-	uint32_t *pixmem32;
-	Uint8 *pixmem8;
-	Uint8 r, g, b;
-	struct planet_internals *p = &planet->big;
+	const SDL_PixelFormat *format = screen->format;
+	struct planet_mip *p = &planet->mip[0];
+	SDL_Surface *sdl_texture, *image;
+	bool ok;
 
 	sdl_texture = IMG_Load(filename);
 	if (sdl_texture == NULL) {
@@ -691,32 +1634,36 @@ bool planet_get_texture_from_file(struct planet *planet, const char *filename,
 		return false;
 	}
 
-	i = 0;
-	for (y = 0; y < p->texture_h; y++) {
-		scaled_y = (y * sdl_texture->h) / p->texture_h;
-		for (x = 0; x < p->texture_w; x++) {
-			scaled_x = (x * sdl_texture->w) / p->texture_w;
-			pixmem8 = (Uint8*)sdl_texture->pixels +
-					scaled_y * sdl_texture->pitch +
-					scaled_x *
-					sdl_texture->format->BytesPerPixel;
-			pixmem32 = (uint32_t*)pixmem8;
-
-			SDL_GetRGB(*pixmem32, sdl_texture->format, &r, &g, &b);
-
-			p->texture[i++] = SDL_MapRGB(screen->format, r, g, b);
+	/* Convert the whole image to the screen's format in one go, so
+	 * texels can be copied without unpacking each one */
+	if (planet_same_format(sdl_texture->format, format)) {
+		image = sdl_texture;
+	} else {
+		image = SDL_ConvertSurface(sdl_texture, screen->format,
+				SDL_SWSURFACE);
+		SDL_FreeSurface(sdl_texture);
+		if (image == NULL) {
+			printf("Couldn't convert %s\n", filename);
+			return false;
 		}
-		i += p->texture_r - p->texture_w;
 	}
 
-	SDL_FreeSurface(sdl_texture);
+	planet_lazy_free(planet);
+
+	ok = planet_resample_texture(p, image,
+			format->Rmask | format->Gmask | format->Bmask, filter);
+	SDL_FreeSurface(image);
+	if (!ok)
+		return false;
 
 	planet__texture_extend(p->texture,
 			p->texture_h,
 			p->texture_r,
 			p->texture_w);
 
-	planet_make_small_texture(planet);
+	planet_free_bump(planet);
+	planet_make_mips(planet);
+	planet_set_update_render(planet);
 
 	return true;
 }
@@ -751,225 +1698,823 @@ static inline struct point_3d planet_point_from_texture_coord(
 	return ret;
 }
 
-bool planet_generate_texture(struct planet *planet,
-		const SDL_Surface *screen)
+static inline int8_t planet_bump_clamp(int64_t slope)
 {
-	struct planet_internals *p = &planet->big;
-	int x, y, i;
-	uint32_t seeds[4];
-	int r = p->texture_h / 2;
-	int h, s;
-	int half_w = p->texture_w / 2;
-	double scaled_pi = M_PI / (double)(half_w);
-	int *sine;
-	struct point_3d pt;
-	struct colour *texture = (void *)p->texture;
-	struct colour prev, next, sea_colour;
+	return (slope < -127) ? -127 : (slope > 127) ? 127 : slope;
+}
+
+/*
+ * Get the slope of the terrain at a texture coordinate, from the gradient of
+ * its height noise at the point given by planet_point_from_texture_coord.
+ *
+ * Slopes are along the texture's x and y directions on the sphere's
+ * surface, scaled to be per planet radius so small and large planets look
+ * equally rugged.
+ */
+static inline struct planet_bump planet_bump_from_gradient(
+		const struct noise_gradient *g,
+		int x, int y, int r, int h, const int *sine, int limit)
+{
+	int64_t sx = sin_lut(x, sine, limit);
+	int64_t cx = cos_lut(x, sine, limit);
+	int64_t u, v, radial;
+
+	/* Around the circle of latitude */
+	u = (g->x * cx - g->z * sx) / FIX_MULTIPLE;
+
+	/* Down the line of longitude, which moves outwards from the axis
+	 * towards the equator */
+	radial = (g->x * sx + g->z * cx) / FIX_MULTIPLE;
+	v = (radial * (r - y) + g->y * h) / r;
+
+	return (struct planet_bump) {
+		.u = planet_bump_clamp((u * r) >> BUMP_SHIFT),
+		.v = planet_bump_clamp((v * r) >> BUMP_SHIFT),
+	};
+}
 
-	/* Allocate sine LUT */
-	sine = malloc((half_w) * (sizeof(int)));
-	if (sine == NULL)
+/* Get mip 0's texture, and its bump map if it has one, from the texture
+ * cache.  Rows are converted to the screen's format as they're copied */
+static bool planet_cache_get_texture(struct planet *planet,
+		const struct planet_cache_key *key, const SDL_Surface *screen)
+{
+	struct planet_mip *p = &planet->mip[0];
+	size_t texels = (size_t)p->texture_w * p->texture_h;
+	size_t size = texels * sizeof(struct colour);
+	const struct planet_bump *bump;
+	const struct colour *texture;
+	struct planet_cache *entry;
+	struct colour_format format;
+	int y;
+
+	if (p->bump != NULL)
+		size += texels * sizeof(*bump);
+
+	if (!planet_cache_load(&entry, key, size))
 		return false;
 
-	/* Fill out sine LUT */
-	for (i = 0; i < half_w; i++) {
-		sine[i] = sin(i * scaled_pi) * (double)FIX_MULTIPLE;
+	texture = planet_cache_get_data(entry);
+	bump = (const void *)(texture + texels);
+	colour_format_init(&format, screen);
+
+	for (y = 0; y < p->texture_h; y++) {
+		colour_texture_to_format(&format,
+				texture + y * p->texture_w,
+				p->texture_w,
+				p->texture + y * p->texture_r);
+
+		if (p->bump != NULL)
+			memcpy(p->bump + y * p->texture_r,
+					bump + y * p->texture_w,
+					p->texture_w * sizeof(*bump));
 	}
 
-	/* Random seeds for texture */
-	seeds[0] = rand();
-	seeds[1] = rand();
-	seeds[2] = rand();
-	seeds[3] = rand();
+	planet_cache_free(entry);
+	return true;
+}
 
-	/* Set feature scaling, for texture generator.  Based on radius */
-	s = 1;
-	while ((r >>= 1) > 0)
-		s++;
+/* Convert a row of texture in a screen's format to canonical colours, for
+ * the cache */
+static void planet_cache_convert_row(const void *pw, const void *row,
+		void *out, size_t row_size)
+{
+	colour_texture_from_format(pw, row, row_size / sizeof(uint32_t), out);
+}
 
-	/* reset radius */
-	r = p->texture_h / 2;
+/* Put mip 0's texture and its bump map in the texture cache.  The texture
+ * is in format, or in canonical colours if format is NULL; the cache gets
+ * canonical colours, converted a row at a time */
+static void planet_cache_put_texture(const struct planet *planet,
+		const struct planet_cache_key *key,
+		const struct colour_format *format)
+{
+	const struct planet_mip *p = &planet->mip[0];
+	struct planet_cache_plane planes[] = {
+		{
+			.data = p->texture,
+			.row_size = p->texture_w * sizeof(struct colour),
+			.pitch = p->texture_r * sizeof(struct colour),
+			.convert = (format != NULL) ?
+					planet_cache_convert_row : NULL,
+			.pw = format,
+		},
+		{
+			.data = p->bump,
+			.row_size = p->texture_w * sizeof(*p->bump),
+			.pitch = p->texture_r * sizeof(*p->bump),
+		},
+	};
+
+	planet_cache_store(key, planes, (p->bump != NULL) ? 2 : 1,
+			p->texture_h);
+}
 
-	/* Create texture */
-	i = 0;
-	for (y = 0; y < p->texture_h; y++) {
+/* Per-planet state for planet_generate_texture's row band jobs */
+struct planet_earth_like {
+	struct planet_mip *p;
+	const int *sine;
+	int half_w;
+	int r;
+	int s;
+	uint32_t seeds[4];
+	uint32_t footprint;
+	uint32_t first;
+	struct colour sea_colour;
+	uint8_t *sea;			/* Which texels are sea, before smoothing */
+	int x0;				/* Columns to generate */
+	int x1;
+
+	/* Scratch space, one of each per thread */
+	struct point_3d *row;
+	struct noise_row *terrain;
+};
+
+/* Get the heights of the texels in the columns being generated, and whether
+ * they're sea.  Heights are kept in the texture until colours replace them */
+static void planet_earth_like_height_band(void *data, unsigned band,
+		unsigned thread)
+{
+	struct planet_earth_like *e = data;
+	struct planet_mip *p = e->p;
+	struct point_3d *row = e->row + thread * p->texture_w;
+	int count = e->x1 - e->x0;
+	int r = e->r;
+	int y = band * PLANET_BAND_ROWS;
+	int end = y + PLANET_BAND_ROWS;
+	int x, h, i;
+
+	if (end > p->texture_h)
+		end = p->texture_h;
+
+	for (; y < end; y++) {
+		i = y * p->texture_r + e->x0;
 		h = sqrt(r * r - ((r - y) * (r - y)));
-		for (x = 0; x < p->texture_w; x++) {
+		for (x = 0; x < count; x++) {
 			/* Get 3D location of this texture coordinate */
-			pt = planet_point_from_texture_coord(x, y, r, h,
-					sine, half_w);
-			texture[i] = texture_earth_like_planet_32bpp(
-					pt, seeds, s, r, y);
-			i++;
+			row[x] = planet_point_from_texture_coord(x + e->x0, y,
+					r, h, e->sine, e->half_w);
 		}
-		i += p->texture_r - p->texture_w;
+
+		/* Get the height values for the whole row at once */
+		noise_get_values_at_pos_flipflop_lod(row, count,
+				e->seeds[0], e->s, e->first, p->texture + i);
+
+		for (x = 0; x < count; x++)
+			e->sea[i + x] = texture_earth_like_is_sea(
+					p->texture[i + x]);
+	}
+}
+
+/* Simple smoothing of a land texel's colour around coastlines, from how
+ * many of its neighbours are sea */
+static inline struct colour planet_earth_like_coast(
+		const struct planet_earth_like *e, struct colour c,
+		int x, int y, int i)
+{
+	const struct planet_mip *p = e->p;
+	const uint8_t *sea = e->sea;
+	int prev = (x == 0) ? i + p->texture_w - 1 : i - 1;
+	int next = (x == p->texture_w - 1) ? i - p->texture_w + 1 : i + 1;
+	int m = 0;
+
+	if (y > 0 && y < p->texture_h - 1)
+		m = 6 * (sea[i - p->texture_r] + sea[i + p->texture_r]);
+
+	if (sea[prev] && sea[next]) {
+		/* Sea on both sides of pixel */
+		m += 14;
+	} else if (sea[prev] || sea[next]) {
+		/* Sea on one side of pixel */
+		m += 8;
+	} else {
+		return c;
 	}
 
-	sea_colour = SEA_COLOUR;
+	return colour_interpolate(c, e->sea_colour, m * FIX_MULTIPLE / 32);
+}
 
-	/* Simple smoothing of the texture around coastlines */
-	i = 0;
-	for (y = 0; y < p->texture_h; y++) {
-		for (x = 0; x < p->texture_w; x++) {
-			if (colour_different(&texture[i], &sea_colour)) {
-				int m = 0;
-				if (x == 0) {
-					prev = texture[i + p->texture_w - 1];
-					next = texture[i + 1];
-				} else if (x == p->texture_w - 1) {
-					prev = texture[i - 1];
-					next = texture[i - p->texture_w + 1];
-				} else {
-					prev = texture[i - 1];
-					next = texture[i + 1];
-				}
-
-				if (y > 0 && y < p->texture_h - 1) {
-					if (!colour_different(
-							&texture[i - p->texture_w],
-							&sea_colour))
-						m += 6;
-					if (!colour_different(
-							&texture[i + p->texture_w],
-							&sea_colour))
-						m += 6;
-				}
-
-				if (!colour_different(&next, &sea_colour) &&
-				    !colour_different(&prev, &sea_colour)) {
-					/* Sea on both sides of pixel */
-					m += 14;
-					texture[i] =
-						colour_interpolate(
-							texture[i],
-							sea_colour,
-							m * FIX_MULTIPLE / 32);
-				} else if (
-				    !colour_different(&next, &sea_colour) ||
-				    !colour_different(&prev, &sea_colour)) {
-					/* Sea on one side of pixel */
-					m += 8;
-					texture[i] =
-						colour_interpolate(
-							texture[i],
-							sea_colour,
-							m * FIX_MULTIPLE / 32);
-				}
+/* Colour texels, smoothing coastlines as it goes.  Smoothing only needs the
+ * sea map, so it can be done in the same pass, in any order */
+static void planet_earth_like_band(void *data, unsigned band, unsigned thread)
+{
+	struct planet_earth_like *e = data;
+	struct planet_mip *p = e->p;
+	struct colour *texture = (void *)p->texture;
+	struct noise_gradient grad;
+	struct colour colour;
+	struct point_3d pt;
+	peltar_noise height;
+	int r = e->r;
+	int y = band * PLANET_BAND_ROWS;
+	int end = y + PLANET_BAND_ROWS;
+	int x, h, i;
+
+	if (end > p->texture_h)
+		end = p->texture_h;
+
+	for (; y < end; y++) {
+		i = y * p->texture_r + e->x0;
+		h = sqrt(r * r - ((r - y) * (r - y)));
+		for (x = e->x0; x < e->x1; x++) {
+			if (e->sea[i]) {
+				texture[i] = e->sea_colour;
+				p->bump[i] = (struct planet_bump) { 0, 0 };
+				i++;
+				continue;
 			}
+
+			pt = planet_point_from_texture_coord(x, y, r, h,
+					e->sine, e->half_w);
+			height = p->texture[i];
+
+			colour = texture_earth_like_planet_32bpp(
+					pt, height, &e->terrain[thread],
+					e->seeds, e->s, e->footprint, r, y);
+			texture[i] = planet_earth_like_coast(e, colour,
+					x, y, i);
+
+			/* Land gets bumps from its height gradient.  Every
+			 * octave adds as much slope as any other, so none
+			 * are culled */
+			noise_get_value_at_pos_flipflop_deriv(pt,
+					e->seeds[0], e->s, &grad);
+			p->bump[i] = planet_bump_from_gradient(&grad,
+					x, y, r, h, e->sine, e->half_w);
 			i++;
 		}
-		i += p->texture_r - p->texture_w;
 	}
+}
 
-	free(sine);
+/* Set up to generate an earth-like texture for mip level p */
+static bool planet_earth_like_init(struct planet_earth_like *e,
+		struct planet_mip *p, const uint32_t seeds[4])
+{
+	unsigned threads = thread_pool_get_threads(planet_threads);
+	unsigned t;
+	int i, r;
+
+	e->p = p;
+	e->half_w = p->texture_w / 2;
+
+	/* Get the sine LUT, and allocate each thread's row of texture points
+	 * and terrain noise cache, and the sea map */
+	e->sine = trig_get_sine(e->half_w, FIX_SHIFT);
+	e->row = malloc(threads * p->texture_w * sizeof(*e->row));
+	e->terrain = malloc(threads * sizeof(*e->terrain));
+	e->sea = malloc(p->texture_r * p->texture_h * sizeof(*e->sea));
+	if (e->sine == NULL || e->row == NULL ||
+			e->terrain == NULL || e->sea == NULL) {
+		free(e->sea);
+		free(e->terrain);
+		free(e->row);
+		return false;
+	}
 
-	planet__texture_extend(p->texture,
-			p->texture_h,
-			p->texture_r,
-			p->texture_w);
+	for (i = 0; i < 4; i++)
+		e->seeds[i] = seeds[i];
+
+	/* Set feature scaling, for texture generator.  Based on radius */
+	r = p->texture_h / 2;
+	e->s = 1;
+	while ((r >>= 1) > 0)
+		e->s++;
+
+	/* reset radius */
+	e->r = p->texture_h / 2;
+
+	/* Texels are about a lattice unit apart, and colour channels are
+	 * 8 bit, so octaves below that precision needn't be evaluated */
+	e->footprint = FIX_MULTIPLE;
+	e->first = noise_octave_limit(e->s, e->footprint, 8);
 
-	colour_texture_to_screen(screen, texture,
-			p->texture_r * p->texture_h,
-			p->texture);
+	for (t = 0; t < threads; t++)
+		noise_row_init_lod(&e->terrain[t], NOISE_FLIPFLOP,
+				e->seeds[1], e->s, e->first);
 
-	planet_make_small_texture(planet);
+	e->sea_colour = SEA_COLOUR;
 
 	return true;
 }
 
+static void planet_earth_like_fini(struct planet_earth_like *e)
+{
+	free(e->sea);
+	free(e->terrain);
+	free(e->row);
+}
 
-bool planet_generate_texture_man_made(struct planet *planet, struct colour c,
-		const SDL_Surface *screen)
+/* Get heights and the sea map for columns x0 to x1 */
+static void planet_earth_like_heights(struct planet_earth_like *e,
+		int x0, int x1)
 {
-	struct planet_internals *p = &planet->big;
-	int x, y, i;
-	uint32_t seeds[4];
-	int r = p->texture_h / 2;
-	int h, s;
-	int half_w = p->texture_w / 2;
-	double scaled_pi = M_PI / (double)(half_w);
-	int *sine;
-	struct point_3d pt;
-	struct cellular_texture *cells;
-	struct colour *texture = (void *)p->texture;
-	peltar_fixed dist, max_dist;
+	unsigned bands = (e->p->texture_h + PLANET_BAND_ROWS - 1) /
+			PLANET_BAND_ROWS;
+
+	e->x0 = x0;
+	e->x1 = x1;
+	thread_pool_run(planet_threads, planet_earth_like_height_band,
+			e, bands);
+}
+
+/* Colour columns x0 to x1, in canonical colours, once they and the
+ * columns either side have heights */
+static void planet_earth_like_colours(struct planet_earth_like *e,
+		int x0, int x1)
+{
+	unsigned bands = (e->p->texture_h + PLANET_BAND_ROWS - 1) /
+			PLANET_BAND_ROWS;
+
+	e->x0 = x0;
+	e->x1 = x1;
+	thread_pool_run(planet_threads, planet_earth_like_band, e, bands);
+}
+
+/* Generate an earth-like texture and bump map, in canonical colours */
+static bool planet_earth_like_generate(struct planet_mip *p,
+		const uint32_t seeds[4])
+{
+	struct planet_earth_like e;
+
+	if (!planet_earth_like_init(&e, p, seeds))
+		return false;
+
+	/* Create texture, once all of the sea map is known */
+	planet_earth_like_heights(&e, 0, p->texture_w);
+	planet_earth_like_colours(&e, 0, p->texture_w);
 
-	/* Allocate sine LUT */
-	sine = malloc((half_w) * (sizeof(int)));
-	if (sine == NULL)
+	planet_earth_like_fini(&e);
+
+	return true;
+}
+
+
+/*
+ * Lazy generation, for big planets.
+ *
+ * Each mip level is split into column bands, which are generated when the
+ * rotation brings them into view, or nearly into view.  Full size bands are
+ * made in two steps: heights and the sea map, which the neighbouring bands'
+ * coastline smoothing needs, and then colours.  Smaller levels' bands are
+ * made from the level above's.
+ */
+
+enum planet_band_state {
+	PLANET_BAND_NONE,
+	PLANET_BAND_HEIGHT,	/* Full size only: heights and sea map done */
+	PLANET_BAND_READY,
+};
+
+struct planet_lazy {
+	struct planet_earth_like e;	/* Until the full size level is done */
+	struct planet_cache_key key;
+
+	uint8_t state[PLANET_MIPS_MAX][PLANET_LAZY_BANDS];
+	int pending[PLANET_MIPS_MAX];	/* Bands not ready, per level */
+	int pending_total;
+};
+
+static inline void planet_lazy_get_band(const struct planet_mip *p, int band,
+		int *x0, int *x1)
+{
+	*x0 = band * p->texture_w / PLANET_LAZY_BANDS;
+	*x1 = (band + 1) * p->texture_w / PLANET_LAZY_BANDS;
+}
+
+static void planet_lazy_free(struct planet *planet)
+{
+	struct planet_lazy *l = planet->lazy;
+
+	if (l == NULL)
+		return;
+
+	if (l->pending[0] > 0)
+		planet_earth_like_fini(&l->e);
+
+	free(l);
+	planet->lazy = NULL;
+}
+
+static bool planet_lazy_create(struct planet *planet,
+		const struct planet_cache_key *key)
+{
+	struct planet_lazy *l;
+	int i, band, x0, x1;
+
+	l = calloc(1, sizeof(*l));
+	if (l == NULL)
 		return false;
 
-	/* Fill out sine LUT */
-	for (i = 0; i < half_w; i++) {
-		sine[i] = sin(i * scaled_pi) * (double)FIX_MULTIPLE;
+	if (!planet_earth_like_init(&l->e, &planet->mip[0], key->seeds)) {
+		free(l);
+		return false;
 	}
 
-	/* Random seeds for texture */
-	seeds[0] = rand();
-	seeds[1] = rand();
-	seeds[2] = rand();
-	seeds[3] = rand();
+	l->key = *key;
+
+	for (i = 0; i < planet->mips; i++) {
+		for (band = 0; band < PLANET_LAZY_BANDS; band++) {
+			planet_lazy_get_band(&planet->mip[i], band, &x0, &x1);
+			if (x0 == x1) {
+				l->state[i][band] = PLANET_BAND_READY;
+			} else {
+				l->pending[i]++;
+				l->pending_total++;
+			}
+		}
+	}
+
+	planet->lazy = l;
+	return true;
+}
+
+/* Get heights for the full size level's columns x0 to x1 */
+static void planet_lazy_heights(struct planet *planet, int x0, int x1)
+{
+	struct planet_lazy *l = planet->lazy;
+	int band, b0, b1;
+
+	for (band = 0; band < PLANET_LAZY_BANDS; band++) {
+		if (l->state[0][band] != PLANET_BAND_NONE)
+			continue;
+
+		planet_lazy_get_band(&planet->mip[0], band, &b0, &b1);
+		if (b0 < x1 && b1 > x0) {
+			planet_earth_like_heights(&l->e, b0, b1);
+			l->state[0][band] = PLANET_BAND_HEIGHT;
+		}
+	}
+}
 
+/* The full size level is done, so the generator's state can go, and the
+ * texture can be cached */
+static void planet_lazy_finish(struct planet *planet,
+		const SDL_Surface *screen)
+{
+	struct planet_lazy *l = planet->lazy;
+	struct colour_format format;
+
+	planet_earth_like_fini(&l->e);
+
+	/* The texture is already in the screen's format, and may be on
+	 * screen, so rows are converted back as they're stored */
+	if (peltar_opts.cache_dir != NULL) {
+		colour_format_init(&format, screen);
+		planet_cache_put_texture(planet, &l->key, &format);
+	}
+}
+
+static void planet_lazy_ensure(struct planet *planet, int level,
+		int x0, int x1, const SDL_Surface *screen);
 
-	if (!cellular_texture_create(&cells, p->texture_h)) {
-		free(sine);
+static void planet_lazy_band(struct planet *planet, int level, int band,
+		const SDL_Surface *screen)
+{
+	struct planet_lazy *l = planet->lazy;
+	struct planet_mip *p = &planet->mip[level];
+	struct colour_format format;
+	int w = p->texture_w;
+	int x0, x1, y;
+
+	planet_lazy_get_band(p, band, &x0, &x1);
+
+	if (level == 0) {
+		/* Coastline smoothing looks at the sea map either side,
+		 * including across the seam */
+		planet_lazy_heights(planet, x0 - 1, x1 + 1);
+		if (x0 == 0)
+			planet_lazy_heights(planet, w - 1, w);
+		if (x1 == w)
+			planet_lazy_heights(planet, 0, 1);
+
+		planet_earth_like_colours(&l->e, x0, x1);
+
+		colour_format_init(&format, screen);
+		for (y = 0; y < p->texture_h; y++) {
+			uint32_t *texture = p->texture + y * p->texture_r;
+
+			colour_texture_to_format(&format,
+					(void *)(texture + x0), x1 - x0,
+					texture + x0);
+		}
+
+		planet__texture_extend_columns(p->texture, p->texture_h,
+				p->texture_r, w, x0, x1);
+		planet__bump_extend_columns(p->bump, p->texture_h,
+				p->texture_r, w, x0, x1);
+	} else {
+		planet_lazy_ensure(planet, level - 1, 2 * x0, 2 * x1, screen);
+
+		planet_make_mip_texture(p, &planet->mip[level - 1], x0, x1);
+		if (p->bump != NULL)
+			planet_make_mip_bump(p, &planet->mip[level - 1],
+					x0, x1);
+	}
+
+	l->state[level][band] = PLANET_BAND_READY;
+	l->pending_total--;
+	if (--l->pending[level] == 0 && level == 0)
+		planet_lazy_finish(planet, screen);
+}
+
+/* Make sure columns x0 to x1 of a mip level are generated.  Columns past
+ * the texture width are in the row span, and copied from the start */
+static void planet_lazy_ensure(struct planet *planet, int level,
+		int x0, int x1, const SDL_Surface *screen)
+{
+	struct planet_lazy *l = planet->lazy;
+	int w = planet->mip[level].texture_w;
+	int band, b0, b1;
+
+	if (x0 >= w) {
+		x0 -= w;
+		x1 -= w;
+	} else if (x1 > w) {
+		planet_lazy_ensure(planet, level, 0, x1 - w, screen);
+		x1 = w;
+	}
+
+	for (band = 0; band < PLANET_LAZY_BANDS; band++) {
+		if (l->state[level][band] == PLANET_BAND_READY)
+			continue;
+
+		planet_lazy_get_band(&planet->mip[level], band, &b0, &b1);
+		if (b0 < x1 && b1 > x0)
+			planet_lazy_band(planet, level, band, screen);
+	}
+}
+
+/* Make sure the columns a render at a rotation reads are generated, with a
+ * margin ahead of them for the next few frames */
+static void planet_lazy_ensure_view(struct planet *planet,
+		const struct planet_internals *p, const SDL_Surface *screen,
+		int rot, int rot2)
+{
+	const struct planet_mip *mip = p->mip;
+	int level = mip - planet->mip;
+	int quarter = mip->texture_w2 / 2 + 2;
+	int ahead = mip->texture_w / PLANET_LAZY_PREFETCH;
+	int left = rot;
+	int right = rot2;
+
+	planet_lazy_ensure(planet, level,
+			left, left + quarter + ahead, screen);
+	planet_lazy_ensure(planet, level,
+			right - quarter, right + 1 + ahead, screen);
+
+	if (planet->lazy->pending_total == 0)
+		planet_lazy_free(planet);
+}
+
+/* Make sure a whole mip level is generated */
+static void planet_lazy_ensure_level(struct planet *planet,
+		const struct planet_internals *p, const SDL_Surface *screen)
+{
+	planet_lazy_ensure(planet, p->mip - planet->mip,
+			0, p->mip->texture_w, screen);
+
+	if (planet->lazy->pending_total == 0)
+		planet_lazy_free(planet);
+}
+
+
+bool planet_generate_texture(struct planet *planet,
+		const SDL_Surface *screen)
+{
+	struct planet_mip *p = &planet->mip[0];
+	struct planet_cache_key key = {
+		.generator = PLANET_CACHE_EARTH_LIKE,
+		.diameter = p->texture_h,
+	};
+
+	planet_lazy_free(planet);
+
+	/* Allocate bump maps */
+	if (!planet_alloc_bump(planet))
 		return false;
+
+	/* Random seeds for texture */
+	key.seeds[0] = rand();
+	key.seeds[1] = rand();
+	key.seeds[2] = rand();
+	key.seeds[3] = rand();
+
+	if (!planet_cache_get_texture(planet, &key, screen)) {
+		/* Big textures are generated as they come into view */
+		if (p->texture_h >= PLANET_LAZY_MIN_SIZE) {
+			if (!planet_lazy_create(planet, &key))
+				return false;
+
+			planet_set_update_render(planet);
+			return true;
+		}
+
+		if (!planet_earth_like_generate(p, key.seeds))
+			return false;
+
+		planet_cache_put_texture(planet, &key, NULL);
+
+		colour_texture_to_screen(screen, (void *)p->texture,
+				p->texture_r * p->texture_h,
+				p->texture);
 	}
 
-	/* Set feature scaling, for texture generator.  Based on radius */
-	s = 0;
-	while ((r >>= 1) > 0)
-		s++;
-	if (s < 1)
-		s = 1;
+	planet__texture_extend(p->texture,
+			p->texture_h,
+			p->texture_r,
+			p->texture_w);
 
-	/* reset radius */
-	r = p->texture_h / 2;
+	planet__bump_extend(p->bump,
+			p->texture_h,
+			p->texture_r,
+			p->texture_w);
 
-	/* Get distances */
-	i = 0;
-	max_dist = 0;
-	for (y = 0; y < p->texture_h; y++) {
+	planet_make_mips(planet);
+
+	planet_set_update_render(planet);
+
+	return true;
+}
+
+/* Per-planet state for planet_generate_texture_man_made's row band jobs */
+struct planet_man_made {
+	struct planet_mip *p;
+	const int *sine;
+	int half_w;
+	int r;
+	int s;
+	uint32_t seeds[4];
+	uint32_t footprint;
+	struct colour c;
+	struct cellular_texture *cells;
+	peltar_fixed max_dist;
+	peltar_fixed *band_max_dist;
+};
+
+static void planet_man_made_dist_band(void *data, unsigned band,
+		unsigned thread)
+{
+	struct planet_man_made *m = data;
+	struct planet_mip *p = m->p;
+	struct point_3d pt;
+	peltar_fixed dist, max_dist = 0;
+	int r = m->r;
+	int y = band * PLANET_BAND_ROWS;
+	int end = y + PLANET_BAND_ROWS;
+	int x, h, i;
+
+	(void)(thread);
+
+	if (end > p->texture_h)
+		end = p->texture_h;
+
+	for (; y < end; y++) {
+		i = y * p->texture_r;
 		h = sqrt(r * r - ((r - y) * (r - y)));
 		for (x = 0; x < p->texture_w; x++) {
 			/* Get 3D location of this texture coordinate */
 			pt = planet_point_from_texture_coord(x, y, r, h,
-					sine, half_w);
-			dist = cellular_texture_get_dist(cells, pt);
+					m->sine, m->half_w);
+			dist = cellular_texture_get_dist(m->cells, pt);
 			p->texture[i++] = dist;
 			if (dist > max_dist)
 				max_dist = dist;
 		}
-		i += p->texture_r - p->texture_w;
 	}
 
-	/* Create texture */
-	i = 0;
-	for (y = 0; y < p->texture_h; y++) {
+	m->band_max_dist[band] = max_dist;
+}
+
+static void planet_man_made_band(void *data, unsigned band, unsigned thread)
+{
+	struct planet_man_made *m = data;
+	struct planet_mip *p = m->p;
+	struct colour *texture = (void *)p->texture;
+	struct point_3d pt;
+	peltar_fixed dist;
+	int r = m->r;
+	int y = band * PLANET_BAND_ROWS;
+	int end = y + PLANET_BAND_ROWS;
+	int x, h, i;
+
+	(void)(thread);
+
+	if (end > p->texture_h)
+		end = p->texture_h;
+
+	for (; y < end; y++) {
+		i = y * p->texture_r;
 		h = sqrt(r * r - ((r - y) * (r - y)));
 		for (x = 0; x < p->texture_w; x++) {
 			dist = p->texture[i];
 			pt = planet_point_from_texture_coord(x, y, r, h,
-					sine, half_w);
+					m->sine, m->half_w);
 			texture[i++] = texture_man_made_32bpp(pt, dist,
-					max_dist, seeds, s, c);
+					m->max_dist, m->seeds, m->s,
+					m->footprint, m->c);
 		}
-		i += p->texture_r - p->texture_w;
+	}
+}
+
+/* Generate a man-made texture, in canonical colours */
+static bool planet_man_made_generate(struct planet_mip *p, struct colour c,
+		const uint32_t seeds[4])
+{
+	struct planet_man_made m = { .p = p, .c = c };
+	unsigned bands = (p->texture_h + PLANET_BAND_ROWS - 1) /
+			PLANET_BAND_ROWS;
+	unsigned b;
+	int i, r;
+
+	m.half_w = p->texture_w / 2;
+
+	/* Get sine LUT */
+	m.sine = trig_get_sine(m.half_w, FIX_SHIFT);
+	if (m.sine == NULL)
+		return false;
+
+	/* Allocate each band's greatest distance */
+	m.band_max_dist = malloc(bands * sizeof(*m.band_max_dist));
+	if (m.band_max_dist == NULL)
+		return false;
+
+	for (i = 0; i < 4; i++)
+		m.seeds[i] = seeds[i];
+
+	if (!cellular_texture_create(&m.cells, p->texture_h, m.seeds[1])) {
+		free(m.band_max_dist);
+		return false;
 	}
 
-	cellular_texture_free(cells);
-	free(sine);
+	/* Set feature scaling, for texture generator.  Based on radius */
+	r = p->texture_h / 2;
+	m.s = 0;
+	while ((r >>= 1) > 0)
+		m.s++;
+	if (m.s < 1)
+		m.s = 1;
+
+	/* reset radius */
+	m.r = p->texture_h / 2;
+
+	/* Texels are about a lattice unit apart, and colour channels are
+	 * 8 bit, so octaves below that precision needn't be evaluated */
+	m.footprint = FIX_MULTIPLE;
+
+	/* Get distances */
+	thread_pool_run(planet_threads, planet_man_made_dist_band, &m, bands);
+
+	m.max_dist = 0;
+	for (b = 0; b < bands; b++) {
+		if (m.band_max_dist[b] > m.max_dist)
+			m.max_dist = m.band_max_dist[b];
+	}
+
+	/* Create texture */
+	thread_pool_run(planet_threads, planet_man_made_band, &m, bands);
+
+	cellular_texture_free(m.cells);
+	free(m.band_max_dist);
+
+	return true;
+}
+
+bool planet_generate_texture_man_made(struct planet *planet, struct colour c,
+		const SDL_Surface *screen)
+{
+	struct planet_mip *p = &planet->mip[0];
+	struct planet_cache_key key = {
+		.generator = PLANET_CACHE_MAN_MADE,
+		.diameter = p->texture_h,
+		.colour = c.r | (c.g << 8) | (c.b << 16),
+	};
+
+	planet_lazy_free(planet);
+	planet_free_bump(planet);
+
+	/* Random seeds for texture */
+	key.seeds[0] = rand();
+	key.seeds[1] = rand();
+	key.seeds[2] = rand();
+	key.seeds[3] = rand();
+
+	if (!planet_cache_get_texture(planet, &key, screen)) {
+		if (!planet_man_made_generate(p, c, key.seeds))
+			return false;
+
+		planet_cache_put_texture(planet, &key, NULL);
+
+		colour_texture_to_screen(screen, (void *)p->texture,
+				p->texture_r * p->texture_h,
+				p->texture);
+	}
 
 	planet__texture_extend(p->texture,
 			p->texture_h,
 			p->texture_r,
 			p->texture_w);
 
-	colour_texture_to_screen(screen, texture,
-			p->texture_r * p->texture_h,
-			p->texture);
-
-	planet_make_small_texture(planet);
+	planet_make_mips(planet);
+	planet_set_update_render(planet);
 
 	return true;
 }
@@ -997,8 +2542,7 @@ int planet_get_mass(const struct planet *p)
 
 void planet_set_lighting(struct planet *p, bool lighting)
 {
-	if (lighting)
-		p->update_render = &planet_update_render_lighting;
-	else
-		p->update_render = &planet_update_render_flat;
+	p->lighting = lighting;
+
+	planet_set_update_render(p);
 }
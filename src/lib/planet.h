@@ -14,8 +14,14 @@ void planet_init(void);
 bool planet_create(struct planet **p, int size);
 void planet_free(struct planet *p);
 
+/* Resampling filters for textures loaded from files */
+enum planet_filter {
+	PLANET_FILTER_NEAREST,
+	PLANET_FILTER_BILINEAR,
+};
+
 bool planet_get_texture_from_file(struct planet *planet, const char *filename,
-		SDL_Surface *screen);
+		SDL_Surface *screen, enum planet_filter filter);
 bool planet_generate_texture(struct planet *planet,
 		const SDL_Surface *screen);
 bool planet_generate_texture_man_made(struct planet *planet, struct colour c,
@@ -25,6 +31,9 @@ void planet_update_render(struct planet *p, SDL_Surface *screen,
 		int screen_x, int screen_y);
 void planet_update_render_scaled(struct planet *p, SDL_Surface *screen,
 		int screen_x, int screen_y);
+bool planet_update_render_size(struct planet *p, SDL_Surface *screen,
+		int screen_x, int screen_y, int size);
+void planet_invalidate_render(struct planet *p);
 
 void planet_plot_texture(struct planet *p, SDL_Surface *screen,
 		int screen_x, int screen_y);
@@ -77,15 +77,23 @@ void player_free(struct player *player)
 bool player_setup_graphics(struct player *p, int size,
 		const SDL_Surface *screen)
 {
-	if (!planet_create(&p->planet, size)) {
+	struct planet *planet;
+
+	if (!planet_create(&planet, size)) {
 		return false;
 	}
 
-	if (!planet_generate_texture_man_made(p->planet, p->colour, screen)) {
-		planet_free(p->planet);
+	if (!planet_generate_texture_man_made(planet, p->colour, screen)) {
+		planet_free(planet);
 		return false;
 	}
 
+	/* Free any previous level's graphic after creating the new one, so
+	 * that the planets can share their geometry if the size is the same */
+	if (p->planet != NULL)
+		planet_free(p->planet);
+	p->planet = planet;
+
 	p->x = 0;
 	p->y = 0;
 	p->scaled_x = 0;
@@ -266,6 +274,27 @@ void player_update_render_scaled(struct player *p, SDL_Surface *screen,
 }
 
 
+void player_invalidate_render(struct player *p)
+{
+	planet_invalidate_render(p->planet);
+}
+
+
+/* Get the screen area of the current direction indicator, if any */
+bool player_get_direction_rect(const struct player *p, SDL_Rect *rect)
+{
+	if (p->direction_size == 0)
+		return false;
+
+	rect->x = p->direction_x;
+	rect->y = p->direction_y;
+	rect->w = p->direction_size;
+	rect->h = p->direction_size;
+
+	return true;
+}
+
+
 void player_set_mouse_pos_to_target(struct player *p)
 {
 	SDL_WarpMouse(p->target_x, p->target_y);
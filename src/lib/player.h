@@ -33,6 +33,8 @@ void player_update_render(struct player *p, SDL_Surface *screen,
 		SDL_Surface *bg);
 void player_update_render_scaled(struct player *p, SDL_Surface *screen,
 		SDL_Surface *bg);
+void player_invalidate_render(struct player *p);
+bool player_get_direction_rect(const struct player *p, SDL_Rect *rect);
 
 int player_get_size(struct player *p);
 int player_get_size_scaled(struct player *p);
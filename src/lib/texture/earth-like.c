@@ -15,6 +15,15 @@ enum earth_like_terrain_type {
 	FOREST
 };
 
+/* Noise values used to colour land, indexes into noise_request array */
+enum earth_like_noise {
+	LAND_VEGETATION, /* Grass and forest shading */
+	LAND_DESERT, /* Light / dark desert selection */
+	LAND_DESERT_LIGHT, /* Light desert shading */
+	LAND_DESERT_DARK, /* Dark desert shading */
+	LAND_COUNT
+};
+
 static inline int interpolate(int64_t a, int64_t b, int f)
 {
 	if (a < b)
@@ -112,15 +121,13 @@ static inline void texture_earth_like_get_thresholds(int y, int r,
 
 }
 
-static inline struct colour texture_earth_like_forest(const struct point_3d p,
-		const uint32_t seeds[4], int s)
+static inline struct colour texture_earth_like_forest(
+		const uint32_t noise[LAND_COUNT])
 {
 	uint8_t texture;
 	struct colour res;
 
-	(void)(s);
-
-	texture = noise_get_value_at_pos_standard(p, seeds[2], 2) >> 24;
+	texture = noise[LAND_VEGETATION] >> 24;
 	texture /= 16;
 	texture += 255 / 8 + 255 / 32;
 
@@ -132,15 +139,13 @@ static inline struct colour texture_earth_like_forest(const struct point_3d p,
 	return res;
 }
 
-static inline struct colour texture_earth_like_grass(const struct point_3d p,
-		const uint32_t seeds[4], int s)
+static inline struct colour texture_earth_like_grass(
+		const uint32_t noise[LAND_COUNT])
 {
 	uint8_t texture;
 	struct colour res;
 
-	(void)(s);
-
-	texture = noise_get_value_at_pos_standard(p, seeds[2], 2) >> 24;
+	texture = noise[LAND_VEGETATION] >> 24;
 	texture /= 8;
 	texture += 255 / 8 + 255 / 16 + 255 / 32 + 255 / 64;
 
@@ -152,54 +157,49 @@ static inline struct colour texture_earth_like_grass(const struct point_3d p,
 	return res;
 }
 
-static inline struct colour texture_earth_like_desert(const struct point_3d p,
-		const uint32_t seeds[4], int s)
+/* Desert value bounds of the light / dark transition */
+#define DESERT_THRESH_1 (((0xffffffff / 16) *  5) / 2 + (0xffffffff / 4))
+#define DESERT_THRESH_2 (((0xffffffff / 16) * 10) / 2 + (0xffffffff / 4))
+
+static inline struct colour texture_earth_like_desert(
+		const uint32_t noise[LAND_COUNT])
 {
 	uint32_t value, texture;
 	struct colour res;
 
-	value = noise_get_value_at_pos_flipflop(p, seeds[3], s - 1);
+	value = noise[LAND_DESERT];
 
-#define THRESH_1 (((0xffffffff / 16) *  5) / 2 + (0xffffffff / 4))
-#define THRESH_2 (((0xffffffff / 16) * 10) / 2 + (0xffffffff / 4))
-
-	if (value < THRESH_1) {
+	if (value < DESERT_THRESH_1) {
 		/* Light / yellow desert */
-		texture = noise_get_value_at_pos_standard(p, seeds[0], 3) >>
-				(32 - FIX_SHIFT);
+		texture = noise[LAND_DESERT_LIGHT] >> (32 - FIX_SHIFT);
 		res = colour_interpolate(
 				DESERT_LIGHT_1, DESERT_LIGHT_2, texture);
 
-	} else if (value < THRESH_2) {
+	} else if (value < DESERT_THRESH_2) {
 		/* Transition desert */
 		struct colour light, dark;
 		uint64_t wide;
-		texture = noise_get_value_at_pos_standard(p, seeds[0], 3) >>
-				(32 - FIX_SHIFT);
+		texture = noise[LAND_DESERT_LIGHT] >> (32 - FIX_SHIFT);
 		light = colour_interpolate(
 				DESERT_LIGHT_1, DESERT_LIGHT_2, texture);
 
-		texture = noise_get_value_at_pos_standard(p, seeds[2], 3) >>
-				(32 - FIX_SHIFT);
+		texture = noise[LAND_DESERT_DARK] >> (32 - FIX_SHIFT);
 		dark = colour_interpolate(
 				DESERT_DARK_1, DESERT_DARK_2, texture);
 
-		wide = ((uint64_t)(value - THRESH_1)) << FIX_SHIFT;
-		texture = (uint32_t)(wide / (uint64_t)(THRESH_2 - THRESH_1));
+		wide = ((uint64_t)(value - DESERT_THRESH_1)) << FIX_SHIFT;
+		texture = (uint32_t)(wide /
+				(uint64_t)(DESERT_THRESH_2 - DESERT_THRESH_1));
 
 		res = colour_interpolate(
 				light, dark, texture);
 	} else {
 		/* Dark / red desert */
-		texture = noise_get_value_at_pos_standard(p, seeds[2], 3) >>
-				(32 - FIX_SHIFT);
+		texture = noise[LAND_DESERT_DARK] >> (32 - FIX_SHIFT);
 		res = colour_interpolate(
 				DESERT_DARK_1, DESERT_DARK_2, texture);
 	}
 
-#undef THRESH_1
-#undef THRESH_2
-
 	return res;
 }
 
@@ -240,56 +240,109 @@ static inline void texture_earth_like_get_terrain_type(uint32_t value,
 	}
 }
 
+/*
+ * Get all the noise values a terrain type needs, in one go.  The desert
+ * value is evaluated first, so only the shades it selects are evaluated.
+ */
+static inline void texture_earth_like_get_noise(const struct point_3d p,
+		const uint32_t seeds[4], int s, uint32_t footprint,
+		enum earth_like_terrain_type type,
+		uint32_t noise[LAND_COUNT])
+{
+	const struct noise_request req[LAND_COUNT] = {
+		[LAND_VEGETATION]   = { NOISE_STANDARD, seeds[2], 2 },
+		[LAND_DESERT_LIGHT] = { NOISE_STANDARD, seeds[0], 3 },
+		[LAND_DESERT_DARK]  = { NOISE_STANDARD, seeds[2], 3 },
+	};
+	struct noise_request want[LAND_COUNT];
+	enum earth_like_noise field[LAND_COUNT];
+	uint32_t value[LAND_COUNT];
+	uint32_t i, count = 0;
+
+	/* Grass and forest share their noise value */
+	if (type != DESERT)
+		field[count++] = LAND_VEGETATION;
+
+	if (type == DESERT || type == DESERT_GRASS) {
+		noise[LAND_DESERT] = noise_get_value_at_pos_flipflop_lod(p,
+				seeds[3], s - 1,
+				noise_octave_limit(s - 1, footprint, 8));
+
+		if (noise[LAND_DESERT] < DESERT_THRESH_2)
+			field[count++] = LAND_DESERT_LIGHT;
+		if (noise[LAND_DESERT] >= DESERT_THRESH_1)
+			field[count++] = LAND_DESERT_DARK;
+	}
+
+	for (i = 0; i < count; i++)
+		want[i] = req[field[i]];
+
+	noise_get_values_at_pos_multi(p, want, count, value);
+
+	for (i = 0; i < count; i++)
+		noise[field[i]] = value[i];
+}
+
+/*
+ * Get the colour of a texel.
+ *
+ * height must be noise_get_value_at_pos_flipflop_lod(p, seeds[0], s, first)
+ * where first is noise_octave_limit(s, footprint, 8), which callers may
+ * evaluate for many points at once.  terrain must be a NOISE_FLIPFLOP row
+ * walker for seeds[1] with s levels from the same first octave, which
+ * should be reused for consecutive texels along a row.
+ */
 struct colour texture_earth_like_planet_32bpp(const struct point_3d p,
-		const uint32_t seeds[4], int s, uint32_t radius, uint32_t y)
+		uint32_t height, struct noise_row *terrain,
+		const uint32_t seeds[4], int s, uint32_t footprint,
+		uint32_t radius, uint32_t y)
 {
 	enum earth_like_terrain_type type;
 	uint32_t value, pos;
 	struct colour res;
 	int levels[4];
-
-	/* Get texture noise value for pixel */
-	value = noise_get_value_at_pos_flipflop(p, seeds[0], s);
-
-#define SEA_LEVEL 0x87000000
+	uint32_t noise[LAND_COUNT];
 
 	/* Decide how to colour the pixel */
-	if (value > SEA_LEVEL) {
+	if (!texture_earth_like_is_sea(height)) {
 		/* Land */
 		/* Get terrain thresholds */
 		texture_earth_like_get_thresholds(y, radius, levels);
 
 		/* Get terrain value */
-		value = noise_get_value_at_pos_flipflop(p, seeds[1], s);
+		value = noise_row_get_value(terrain, p);
 
 		/* Get terrain type, and any transition value */
 		texture_earth_like_get_terrain_type(value, levels, &type, &pos);
 
+		texture_earth_like_get_noise(p, seeds, s, footprint,
+				type, noise);
+
 		switch (type) {
 		case DESERT:
-			res = texture_earth_like_desert(p, seeds, s);
+			res = texture_earth_like_desert(noise);
 			break;
 
 		case DESERT_GRASS:
 			res = colour_interpolate(
-					texture_earth_like_desert(p, seeds, s),
-					texture_earth_like_grass(p, seeds, s),
+					texture_earth_like_desert(noise),
+					texture_earth_like_grass(noise),
 					pos);
 			break;
 
 		case GRASS:
-			res = texture_earth_like_grass(p, seeds, s);
+			res = texture_earth_like_grass(noise);
 			break;
 
 		case GRASS_FOREST:
 			res = colour_interpolate(
-					texture_earth_like_grass(p, seeds, s),
-					texture_earth_like_forest(p, seeds, s),
+					texture_earth_like_grass(noise),
+					texture_earth_like_forest(noise),
 					pos);
 			break;
 
 		case FOREST:
-			res = texture_earth_like_forest(p, seeds, s);
+			res = texture_earth_like_forest(noise);
 			break;
 		}
 	} else {
@@ -297,8 +350,6 @@ struct colour texture_earth_like_planet_32bpp(const struct point_3d p,
 		res = SEA_COLOUR;
 	}
 
-#undef SEA_LEVEL
-
 	return res;
 }
 
@@ -2,15 +2,29 @@
 #ifndef _PELTAR_TEXTURE_EARTH_LIKE_H_
 #define _PELTAR_TEXTURE_EARTH_LIKE_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "../image.h"
 #include "../colours.h"
 
 struct point_3d;
+struct noise_row;
+
+/* Heights at or below this are sea */
+#define TEXTURE_EARTH_LIKE_SEA_LEVEL 0x87000000
+
+/* Whether a texel is sea, from the height given to
+ * texture_earth_like_planet_32bpp.  Sea texels are SEA_COLOUR */
+static inline bool texture_earth_like_is_sea(uint32_t height)
+{
+	return height <= TEXTURE_EARTH_LIKE_SEA_LEVEL;
+}
 
 struct colour texture_earth_like_planet_32bpp(struct point_3d p,
-		const uint32_t seeds[4], int s, uint32_t radius, uint32_t y);
+		uint32_t height, struct noise_row *terrain,
+		const uint32_t seeds[4], int s, uint32_t footprint,
+		uint32_t radius, uint32_t y);
 
 #endif
 
@@ -7,8 +7,17 @@
 
 struct colour texture_man_made_32bpp(struct point_3d p,
 		peltar_fixed dist, peltar_fixed max_dist,
-		const uint32_t seeds[4], int s, struct colour c)
+		const uint32_t seeds[4], int s, uint32_t footprint,
+		struct colour c)
 {
+	/* Only the top 5 bits of each noise value are used */
+	const struct noise_request req[2] = {
+		{ NOISE_STANDARD, seeds[0], s,
+				noise_octave_limit(s, footprint, 5) },
+		{ NOISE_STANDARD, seeds[3], s / 2,
+				noise_octave_limit(s / 2, footprint, 5) },
+	};
+	peltar_noise noise[2];
 	peltar_fixed n;
 	uint32_t r, g, b;
 
@@ -19,8 +28,10 @@ struct colour texture_man_made_32bpp(struct point_3d p,
 	g = (c.g * dist / max_dist) & 0xff;
 	b = (c.b * dist / max_dist) & 0xff;
 
-	n  = (noise_get_value_at_pos_standard(p, seeds[0], s  ) >> 24) / 8;
-	n += (noise_get_value_at_pos_standard(p, seeds[3], s/2) >> 24) / 8;
+	noise_get_values_at_pos_multi(p, req, 2, noise);
+
+	n  = (noise[0] >> 24) / 8;
+	n += (noise[1] >> 24) / 8;
 
 	r += n;
 	g += n;
@@ -11,7 +11,8 @@ struct point_3d;
 
 struct colour texture_man_made_32bpp(struct point_3d p,
 		peltar_fixed dist, peltar_fixed max_dist,
-		const uint32_t seeds[4], int s, struct colour c);
+		const uint32_t seeds[4], int s, uint32_t footprint,
+		struct colour c);
 
 #endif
 
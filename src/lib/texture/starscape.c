@@ -1,5 +1,6 @@
 
 #include <stdbool.h>
+#include <stdlib.h>
 
 #include <SDL/SDL.h>
 
@@ -9,15 +10,23 @@
 #include "../image.h"
 #include "../types.h"
 
+/* Noise fields evaluated for every pixel */
+enum starscape_field {
+	FIELD_BLUE, /* Nebula blue component */
+	FIELD_RED, /* Nebula red component */
+	FIELD_DENSITY, /* Star density */
+	FIELD_COUNT
+};
+
 static inline struct colour texture_starscape_star(const struct point_3d p,
-		uint32_t seed)
+		uint32_t seed, peltar_noise field)
 {
 	struct colour ret = { 0 };
 	uint32_t texture;
 	uint32_t density;
 
 	texture = noise_random(p.x, p.y, p.z, seed) >> 24;
-	density = noise_get_value_at_pos_standard_range_2d(p, seed, 8, 4) >> 24;
+	density = field >> 24;
 
 	texture += ((density > 128) ? density - 128 : 128 - density) / 2;
 
@@ -72,20 +81,21 @@ static inline struct colour texture_add_colours(
 }
 
 static inline uint32_t texture_starscape_get_nebula_component(
-		const struct point_3d p, uint32_t seed)
+		peltar_noise field)
 {
 	uint32_t t;
-	t = noise_get_value_at_pos_standard_range_2d(p, seed, 9, 4);
-	t = (t >> 24) / 4;
+	t = (field >> 24) / 4;
 	return (t > 0x0f) ? t - 0x0f : 0;
 }
 
 static inline struct colour texture_starscape_add_nebula(
-		const struct point_3d p, const uint32_t seeds[3])
+		const peltar_noise fields[FIELD_COUNT])
 {
 	struct colour pixel = { 0 };
-	uint32_t blue = texture_starscape_get_nebula_component(p, seeds[0]);
-	uint32_t red  = texture_starscape_get_nebula_component(p, seeds[1]);
+	uint32_t blue = texture_starscape_get_nebula_component(
+			fields[FIELD_BLUE]);
+	uint32_t red  = texture_starscape_get_nebula_component(
+			fields[FIELD_RED]);
 
 	pixel.r = (blue >> 2) + (red     );
 	pixel.g = (blue >> 2) + (red >> 2);
@@ -97,20 +107,21 @@ static inline struct colour texture_starscape_add_nebula(
 static inline void texture_starscape_get_edge_pixel(
 		struct colour *restrict pixel,
 		const struct point_3d p,
-		const uint32_t seeds[3])
+		const uint32_t seeds[3],
+		const peltar_noise fields[FIELD_COUNT])
 {
 	/* Nebula */
 	*pixel = texture_add_colours(*pixel,
-			texture_starscape_add_nebula(p, seeds));
+			texture_starscape_add_nebula(fields));
 
 	/* Stars */
-	*pixel = texture_add_colours(*pixel,
-			texture_starscape_star(p, seeds[2]));
+	*pixel = texture_add_colours(*pixel, texture_starscape_star(p,
+			seeds[2], fields[FIELD_DENSITY]));
 }
 
 static inline void texture_starscape_get_pixel(struct colour *restrict pixel,
 		const struct point_3d p, const uint32_t seeds[3],
-		uint32_t stride)
+		const peltar_noise fields[FIELD_COUNT], uint32_t stride)
 {
 	struct colour star;
 	struct colour star4;
@@ -118,10 +129,10 @@ static inline void texture_starscape_get_pixel(struct colour *restrict pixel,
 
 	/* Nebula */
 	*pixel = texture_add_colours(*pixel,
-			texture_starscape_add_nebula(p, seeds));
+			texture_starscape_add_nebula(fields));
 
 	/* Star */
-	star = texture_starscape_star(p, seeds[2]);
+	star = texture_starscape_star(p, seeds[2], fields[FIELD_DENSITY]);
 	if (star.r == 0 && star.g == 0 && star.b == 0)
 		return;
 
@@ -165,63 +176,89 @@ static void starscape_colour_to_suface_format(struct image *image)
 	size_t width = image_get_width(image);
 	struct colour *colour = render->pixels;
 	uint32_t *pixel = render->pixels;
+	struct colour_format format;
+
+	colour_format_init(&format, render);
 
 	for (size_t y = 0; y < height; y++) {
-		colour_texture_to_screen(render, colour, width, pixel);
+		colour_texture_to_format(&format, colour, width, pixel);
 		colour += stride;
 		pixel += stride;
 	}
 
 }
 
+/* Get the noise field values for the pixel at x of a row */
+static inline void texture_starscape_get_fields(
+		peltar_noise fields[FIELD_COUNT],
+		const peltar_noise *row, uint32_t width, uint32_t x)
+{
+	fields[FIELD_BLUE]    = row[FIELD_BLUE    * width + x];
+	fields[FIELD_RED]     = row[FIELD_RED     * width + x];
+	fields[FIELD_DENSITY] = row[FIELD_DENSITY * width + x];
+}
+
 bool texture_get_starscape(struct image *image)
 {
 	SDL_Surface *render = image_get_surface(image);
 	uint32_t stride = render->pitch / peltar_opts.screen_bpp;
 	struct colour *row_start = (struct colour *)render->pixels;
-	unsigned int w = image_get_width(image) << FIX_SHIFT;
-	unsigned int h = image_get_height(image) << FIX_SHIFT;
+	uint32_t width = image_get_width(image);
+	uint32_t height = image_get_height(image);
 	uint32_t seeds[3];
+	struct noise_field_2d field[FIELD_COUNT];
+	peltar_noise fields[FIELD_COUNT];
+	peltar_noise *row;
 	struct colour *pixel;
 	struct point_3d p = {
 		.x = 0,
 		.y = 0,
 		.z = 0
 	};
+	uint32_t x, y;
 
-	memset(row_start, 0, render->pitch * image_get_height(image));
+	/* Noise values for every field along a row */
+	row = malloc(FIELD_COUNT * width * sizeof(*row));
+	if (row == NULL)
+		return false;
+
+	memset(row_start, 0, render->pitch * height);
 
 	seeds[0] = rand();
 	seeds[1] = rand();
 	seeds[2] = rand();
 
-	/* Top row */
-	pixel = row_start;
-	for (p.x = 0; p.x < w; p.x += FIX_MULTIPLE) {
-		texture_starscape_get_edge_pixel(pixel++, p, seeds);
-	}
-	row_start += stride;
+	/* Nebula blue and red components, and star density */
+	field[FIELD_BLUE]    = (struct noise_field_2d) { seeds[0], 9, 4 };
+	field[FIELD_RED]     = (struct noise_field_2d) { seeds[1], 9, 4 };
+	field[FIELD_DENSITY] = (struct noise_field_2d) { seeds[2], 8, 4 };
+
+	for (y = 0; y < height; y++) {
+		p.y = y << FIX_SHIFT;
+		noise_get_row_2d(field, FIELD_COUNT, 0, p.y, FIX_MULTIPLE,
+				width, row);
 
-	/* Up to last row */
-	for (p.y = FIX_MULTIPLE; p.y < h - FIX_MULTIPLE; p.y += FIX_MULTIPLE) {
 		pixel = row_start;
-		texture_starscape_get_edge_pixel(pixel++, p, seeds);
-		for (p.x = FIX_MULTIPLE; p.x < w - FIX_MULTIPLE;
-				p.x += FIX_MULTIPLE) {
-			texture_starscape_get_pixel(pixel++, p, seeds, stride);
+		for (x = 0; x < width; x++) {
+			p.x = x << FIX_SHIFT;
+			texture_starscape_get_fields(fields, row, width, x);
+
+			/* Stars on the edges aren't smeared out of the image */
+			if (y == 0 || y == height - 1 ||
+					x == 0 || x == width - 1) {
+				texture_starscape_get_edge_pixel(pixel++, p,
+						seeds, fields);
+			} else {
+				texture_starscape_get_pixel(pixel++, p, seeds,
+						fields, stride);
+			}
 		}
-		texture_starscape_get_edge_pixel(pixel++, p, seeds);
 		row_start += stride;
 	}
 
-	/* Last row */
-	pixel = row_start;
-	for (p.x = 0; p.x < w; p.x += FIX_MULTIPLE) {
-		texture_starscape_get_edge_pixel(pixel++, p, seeds);
-	}
+	free(row);
 
 	starscape_colour_to_suface_format(image);
 
 	return true;
 }
-
@@ -0,0 +1,198 @@
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include <SDL/SDL_mutex.h>
+
+#include "thread-pool.h"
+
+
+#define THREAD_POOL_MAX 64
+
+struct thread_pool_worker {
+	struct thread_pool *pool;
+	SDL_Thread *thread;
+	unsigned index;
+};
+
+struct thread_pool {
+	SDL_mutex *lock;
+	SDL_cond *work;		/* Signalled when there are jobs, or on quit */
+	SDL_cond *done;		/* Signalled when the last job finishes */
+
+	unsigned threads;	/* Workers plus the thread_pool_run caller */
+	struct thread_pool_worker *workers;
+
+	/* Current batch of jobs, all protected by lock */
+	thread_pool_job fn;
+	void *data;
+	unsigned jobs;
+	unsigned next;		/* Next job to hand out */
+	unsigned busy;		/* Jobs handed out and not yet finished */
+	bool quit;
+};
+
+
+static unsigned thread_pool_get_cpus(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (cpus > 0)
+		return cpus;
+#endif
+	return 1;
+}
+
+
+/* Take jobs until there are none left.  Called and returns with the lock
+ * held */
+static void thread_pool_do_jobs(struct thread_pool *pool, unsigned index)
+{
+	while (pool->next < pool->jobs) {
+		unsigned job = pool->next++;
+
+		pool->busy++;
+		SDL_mutexV(pool->lock);
+
+		pool->fn(pool->data, job, index);
+
+		SDL_mutexP(pool->lock);
+		pool->busy--;
+	}
+
+	if (pool->busy == 0)
+		SDL_CondSignal(pool->done);
+}
+
+
+static int thread_pool_worker(void *data)
+{
+	struct thread_pool_worker *w = data;
+	struct thread_pool *pool = w->pool;
+
+	SDL_mutexP(pool->lock);
+	while (!pool->quit) {
+		if (pool->next < pool->jobs)
+			thread_pool_do_jobs(pool, w->index);
+		else
+			SDL_CondWait(pool->work, pool->lock);
+	}
+	SDL_mutexV(pool->lock);
+
+	return 0;
+}
+
+
+bool thread_pool_create(struct thread_pool **pool, unsigned threads)
+{
+	struct thread_pool *t;
+	unsigned i;
+
+	if (threads == 0)
+		threads = thread_pool_get_cpus();
+	if (threads > THREAD_POOL_MAX)
+		threads = THREAD_POOL_MAX;
+
+	t = calloc(1, sizeof(*t));
+	if (t == NULL)
+		return false;
+
+	t->workers = calloc(threads, sizeof(*t->workers));
+	t->lock = SDL_CreateMutex();
+	t->work = SDL_CreateCond();
+	t->done = SDL_CreateCond();
+	if (t->workers == NULL || t->lock == NULL ||
+			t->work == NULL || t->done == NULL) {
+		thread_pool_free(t);
+		return false;
+	}
+
+	/* The caller of thread_pool_run is thread 0, so it needs no worker */
+	t->threads = 1;
+	for (i = 1; i < threads; i++) {
+		struct thread_pool_worker *w = &t->workers[i];
+
+		w->pool = t;
+		w->index = i;
+		w->thread = SDL_CreateThread(thread_pool_worker, w);
+		if (w->thread == NULL)
+			break;
+		t->threads++;
+	}
+
+	*pool = t;
+	return true;
+}
+
+
+void thread_pool_free(struct thread_pool *pool)
+{
+	unsigned i;
+
+	if (pool == NULL)
+		return;
+
+	if (pool->lock != NULL) {
+		SDL_mutexP(pool->lock);
+		pool->quit = true;
+		SDL_CondBroadcast(pool->work);
+		SDL_mutexV(pool->lock);
+
+		for (i = 1; i < pool->threads; i++)
+			SDL_WaitThread(pool->workers[i].thread, NULL);
+	}
+
+	if (pool->done != NULL)
+		SDL_DestroyCond(pool->done);
+	if (pool->work != NULL)
+		SDL_DestroyCond(pool->work);
+	if (pool->lock != NULL)
+		SDL_DestroyMutex(pool->lock);
+
+	free(pool->workers);
+	free(pool);
+}
+
+
+unsigned thread_pool_get_threads(const struct thread_pool *pool)
+{
+	if (pool == NULL)
+		return 1;
+
+	return pool->threads;
+}
+
+
+void thread_pool_run(struct thread_pool *pool, thread_pool_job fn,
+		void *data, unsigned jobs)
+{
+	unsigned i;
+
+	if (pool == NULL || pool->threads == 1 || jobs == 1) {
+		for (i = 0; i < jobs; i++)
+			fn(data, i, 0);
+		return;
+	}
+
+	SDL_mutexP(pool->lock);
+
+	pool->fn = fn;
+	pool->data = data;
+	pool->jobs = jobs;
+	pool->next = 0;
+	SDL_CondBroadcast(pool->work);
+
+	thread_pool_do_jobs(pool, 0);
+
+	while (pool->busy > 0)
+		SDL_CondWait(pool->done, pool->lock);
+
+	SDL_mutexV(pool->lock);
+}
+
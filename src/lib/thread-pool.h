@@ -0,0 +1,27 @@
+
+#ifndef _PELTAR_THREAD_POOL_H_
+#define _PELTAR_THREAD_POOL_H_
+
+#include <stdbool.h>
+
+struct thread_pool;
+
+/* Job callback.  Gets the data passed to thread_pool_run, the index of the
+ * job to do, and the index of the thread doing it, for per-thread scratch
+ * space.  Jobs may run in any order, on any thread. */
+typedef void (*thread_pool_job)(void *data, unsigned job, unsigned thread);
+
+/* Create a pool of threads workers; 0 for one per online CPU */
+bool thread_pool_create(struct thread_pool **pool, unsigned threads);
+void thread_pool_free(struct thread_pool *pool);
+
+/* Number of threads that may run jobs, including the caller of
+ * thread_pool_run.  A NULL pool has one: the caller. */
+unsigned thread_pool_get_threads(const struct thread_pool *pool);
+
+/* Run jobs 0 to jobs - 1, and wait for them all to finish */
+void thread_pool_run(struct thread_pool *pool, thread_pool_job fn,
+		void *data, unsigned jobs);
+
+#endif
+
@@ -0,0 +1,88 @@
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "trig.h"
+
+#ifndef M_PI
+#define M_PI	3.14159265358979323846
+#endif
+
+enum trig_function {
+	TRIG_SINE,
+	TRIG_ARC_COSINE,
+};
+
+struct trig_table {
+	enum trig_function function;
+	int size;
+	int shift;
+	struct trig_table *next;
+	int values[];
+};
+
+static struct trig_table *trig_tables;
+
+static void trig_fill_sine(int *values, int size, int shift)
+{
+	double scaled_pi = M_PI / (double)(size);
+
+	for (int i = 0; i < size; i++)
+		values[i] = sin(i * scaled_pi) * (double)(1 << shift);
+}
+
+static void trig_fill_arc_cosine(int *values, int size, int shift)
+{
+	double arg, res;
+
+	for (int i = 0; i < size; i++) {
+		arg = i / (double)(size);
+		res = acos(arg);
+
+		/* Factor out pi, and store as fixed point */
+		values[i] = (res / M_PI) * (1 << shift);
+	}
+}
+
+static const int *trig_get(enum trig_function function, int size, int shift)
+{
+	struct trig_table *t;
+
+	for (t = trig_tables; t != NULL; t = t->next) {
+		if (t->function == function &&
+				t->size == size && t->shift == shift)
+			return t->values;
+	}
+
+	t = malloc(sizeof(*t) + size * sizeof(*t->values));
+	if (t == NULL)
+		return NULL;
+
+	t->function = function;
+	t->size = size;
+	t->shift = shift;
+
+	switch (function) {
+	case TRIG_SINE:
+		trig_fill_sine(t->values, size, shift);
+		break;
+	case TRIG_ARC_COSINE:
+		trig_fill_arc_cosine(t->values, size, shift);
+		break;
+	}
+
+	t->next = trig_tables;
+	trig_tables = t;
+
+	return t->values;
+}
+
+const int *trig_get_sine(int size, int shift)
+{
+	return trig_get(TRIG_SINE, size, shift);
+}
+
+const int *trig_get_arc_cosine(int size, int shift)
+{
+	return trig_get(TRIG_ARC_COSINE, size, shift);
+}
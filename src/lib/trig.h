@@ -0,0 +1,22 @@
+
+#ifndef _PELTAR_TRIG_H_
+#define _PELTAR_TRIG_H_
+
+/*
+ * Shared trigonometry lookup tables.
+ *
+ * Each table is built the first time it's asked for, and kept for the life
+ * of the process, so generating textures of a size seen before doesn't call
+ * libm.  Tables are read only once built, but getting them isn't thread
+ * safe; worker threads should be handed them.
+ */
+
+/* Get a table of sin(i * pi / size), for i from 0 to size - 1, as fixed
+ * point with shift fraction bits.  NULL if it couldn't be allocated */
+const int *trig_get_sine(int size, int shift);
+
+/* Get a table of acos(i / size) / pi, for i from 0 to size - 1, as fixed
+ * point with shift fraction bits.  NULL if it couldn't be allocated */
+const int *trig_get_arc_cosine(int size, int shift);
+
+#endif
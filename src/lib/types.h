@@ -28,6 +28,10 @@ struct peltar_config {
 	uint64_t screen_height;
 	uint64_t screen_bpp;
 	uint64_t screen_depth;
+	uint64_t threads;
+	uint64_t seed;
+	int64_t fade;
+	const char *cache_dir;
 };
 
 extern struct peltar_config peltar_opts;
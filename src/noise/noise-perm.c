@@ -0,0 +1,88 @@
+
+
+/*
+ * Permutation table noise hash tables.
+ *
+ * The permutation is Ken Perlin's reference table, repeated so that a
+ * table entry plus a lattice coordinate byte never needs masking.
+ *
+ * Each value's top byte is its index, so the values cover the 32-bit range
+ * evenly.  The low bits come from the multiplicative noise_random_mul().
+ */
+
+#include "noise.h"
+
+#define NOISE_PERM_TABLE \
+	151, 160, 137,  91,  90,  15, 131,  13, 201,  95,  96,  53, \
+	194, 233,   7, 225, 140,  36, 103,  30,  69, 142,   8,  99, \
+	 37, 240,  21,  10,  23, 190,   6, 148, 247, 120, 234,  75, \
+	  0,  26, 197,  62,  94, 252, 219, 203, 117,  35,  11,  32, \
+	 57, 177,  33,  88, 237, 149,  56,  87, 174,  20, 125, 136, \
+	171, 168,  68, 175,  74, 165,  71, 134, 139,  48,  27, 166, \
+	 77, 146, 158, 231,  83, 111, 229, 122,  60, 211, 133, 230, \
+	220, 105,  92,  41,  55,  46, 245,  40, 244, 102, 143,  54, \
+	 65,  25,  63, 161,   1, 216,  80,  73, 209,  76, 132, 187, \
+	208,  89,  18, 169, 200, 196, 135, 130, 116, 188, 159,  86, \
+	164, 100, 109, 198, 173, 186,   3,  64,  52, 217, 226, 250, \
+	124, 123,   5, 202,  38, 147, 118, 126, 255,  82,  85, 212, \
+	207, 206,  59, 227,  47,  16,  58,  17, 182, 189,  28,  42, \
+	223, 183, 170, 213, 119, 248, 152,   2,  44, 154, 163,  70, \
+	221, 153, 101, 155, 167,  43, 172,   9, 129,  22,  39, 253, \
+	 19,  98, 108, 110,  79, 113, 224, 232, 178, 185, 112, 104, \
+	218, 246,  97, 228, 251,  34, 242, 193, 238, 210, 144,  12, \
+	191, 179, 162, 241,  81,  51, 145, 235, 249,  14, 239, 107, \
+	 49, 192, 214,  31, 181, 199, 106, 157, 184,  84, 204, 176, \
+	115, 121,  50,  45, 127,   4, 150, 254, 138, 236, 205,  93, \
+	222, 114,  67,  29,  24,  72, 243, 141, 128, 195,  78,  66, \
+	215,  61, 156, 180,
+
+const uint8_t noise_perm[512] = {
+	NOISE_PERM_TABLE
+	NOISE_PERM_TABLE
+};
+
+const uint32_t noise_perm_value[256] = {
+	0x0008dd0d, 0x010252e9, 0x0274559f, 0x03d77209, 0x04a43501, 0x05532b61,
+	0x065d03a9, 0x07e7c489, 0x0888cdc9, 0x099760ab, 0x0a617521, 0x0bab1c69,
+	0x0c42a15f, 0x0dbc39e1, 0x0e84c785, 0x0fa4c6e1, 0x108f9d29, 0x11e6618d,
+	0x1258f8a1, 0x13ad9c6b, 0x14c020a1, 0x153a8239, 0x16ac2d1f, 0x17d08019,
+	0x18081e81, 0x19568261, 0x1a4fa8f9, 0x1b10ee09, 0x1c364dd9, 0x1dabf8d3,
+	0x1e0aec21, 0x1f5c77b9, 0x20c8f8df, 0x214144e1, 0x2203e60d, 0x23805de1,
+	0x2403ee79, 0x2513e015, 0x260963a1, 0x27e4ac93, 0x2859d7a1, 0x29653809,
+	0x2a4a3cef, 0x2b407009, 0x2c460801, 0x2d3a5961, 0x2eab84c9, 0x2fdeea99,
+	0x30678bc9, 0x3120cfab, 0x32c4e321, 0x33edb989, 0x34ec38af, 0x35371601,
+	0x36b12a85, 0x379c74e1, 0x38ced649, 0x398a429d, 0x3a2a18c1, 0x3b520b6b,
+	0x3c640ea1, 0x3da21839, 0x3e4b746f, 0x3f1622b9, 0x401df181, 0x41beb061,
+	0x42487ef9, 0x43bed419, 0x4448e479, 0x4582d223, 0x464f5a21, 0x47fe8db9,
+	0x487ff02f, 0x49483101, 0x4a84471d, 0x4bb90be1, 0x4c674479, 0x4d584315,
+	0x4e8893c1, 0x4fc895e3, 0x509ec5a1, 0x51561ee9, 0x52b4583f, 0x53f76e09,
+	0x547c4921, 0x55a38761, 0x566b0003, 0x57dae8a9, 0x585449c9, 0x59265b4b,
+	0x5a6a5121, 0x5ba8cf7d, 0x5cdf83ff, 0x5d9165e1, 0x5e66d1a5, 0x5f9622e1,
+	0x609ca3c3, 0x611443ad, 0x62fba4a1, 0x6356b70b, 0x64c9fca1, 0x650e95a1,
+	0x66e9efbf, 0x67359c19, 0x687db2a1, 0x69a8de61, 0x6a0d11cb, 0x6bdc9229,
+	0x6c8ae9d9, 0x6d302773, 0x6ed5c821, 0x6fbf7625, 0x70eb9b7f, 0x716c70e1,
+	0x724bc82d, 0x73f3b9e1, 0x749ded8b, 0x75aca615, 0x76c20fa1, 0x77387b33,
+	0x78a5b3a1, 0x79cdff21, 0x7a4d1aef, 0x7bfc6c09, 0x7c691c21, 0x7d8eb561,
+	0x7e8fadf3, 0x7fc29099, 0x804f07c9, 0x81b04a4b, 0x8251bf21, 0x83934cad,
+	0x847916af, 0x85290041, 0x864934a5, 0x8791d0e1, 0x881e81b3, 0x8993889d,
+	0x8a58cb01, 0x8b0ba60b, 0x8cf1eaa1, 0x8db768a1, 0x8e22526f, 0x8f4171f9,
+	0x90fe85a1, 0x91150c61, 0x927900cb, 0x93ba7a19, 0x949e5bb9, 0x9551f023,
+	0x969e3621, 0x97a9d925, 0x9860ce2f, 0x99933b41, 0x9a6d8d1d, 0x9b3067e1,
+	0x9c74dc8b, 0x9d110915, 0x9e546601, 0x9fe5b3e3, 0xa06ea1a1, 0xa18ad221,
+	0xa29f119f, 0xa34f6a09, 0xa4f5fd41, 0xa51821e1, 0xa6e91e03, 0xa7f5ecc9,
+	0xa8843049, 0xa9c51cab, 0xaa7b2d21, 0xab8d8dbd, 0xacd83881, 0xadbe91e1,
+	0xae6f9bc5, 0xaf691d61, 0xb0c8c1c3, 0xb151fbf9, 0xb2c09d21, 0xb347586b,
+	0xb4dbd8a1, 0xb5a4c9c1, 0xb60ea739, 0xb712b819, 0xb840e6c1, 0xb9a238e1,
+	0xba43132b, 0xbb7a5d41, 0xbceb7c59, 0xbdf934d3, 0xbea8a421, 0xbf954045,
+	0xc0429381, 0xc1ef9ce1, 0xc2c4aa4d, 0xc3db7461, 0xc48dceeb, 0xc505a409,
+	0xc6ab4821, 0xc7ade893, 0xc8f98fa1, 0xc9ddb341, 0xca472a49, 0xcbf06809,
+	0xcc85d041, 0xcd2ccfe1, 0xceeefb53, 0xcfb193e1, 0xd0216e49, 0xd1fe8bab,
+	0xd2e69b21, 0xd33a2ecd, 0xd4b55f21, 0xd579ee01, 0xd65ffec5, 0xd7ae4b61,
+	0xd8922f13, 0xd92ea219, 0xda0f9541, 0xdb9bc76b, 0xdc87c6a1, 0xdd509cc1,
+	0xdefe2659, 0xdf6edab9, 0xe084b9c1, 0xe177e6e1, 0xe2fe822b, 0xe3039ee1,
+	0xe4010af9, 0xe5724f63, 0xe6f51221, 0xe7eda345, 0xe8a10a21, 0xe9770901,
+	0xead6d31d, 0xeba1a261, 0xeca43deb, 0xedd0a209, 0xee545041, 0xef035323,
+	0xf0467da1, 0xf1bd8641, 0xf2ce6849, 0xf3df6609, 0xf41f9521, 0xf5437de1,
+	0xf6d73c03, 0xf7995001, 0xf84cac49, 0xf999e08b, 0xfa940921, 0xfbc6d3bd,
+	0xfc04b741, 0xfd43bde1, 0xfe105da5, 0xff757961,
+};
@@ -0,0 +1,504 @@
+
+
+#include <stddef.h>
+
+#include "noise-simd.h"
+#include "../lib/cpu.h"
+#include "../lib/types.h"
+
+/* The kernels implement the multiplicative hash only */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+		!defined(NOISE_HASH_PERM)
+#define NOISE_SIMD_X86
+#endif
+
+#ifdef NOISE_SIMD_X86
+
+#include <immintrin.h>
+
+#define FIX_SHIFT 14
+#define FIX_MULTIPLE (1 << FIX_SHIFT)
+#define FIX_MASK (FIX_MULTIPLE - 1)
+
+/* Lattice corner offsets in the hash's linear combination */
+#define HASH_X 1619
+#define HASH_Y 31337
+#define HASH_Z 6971
+#define HASH_SEED 1013
+
+#define SSE41 __attribute__((target("sse4.1")))
+#define AVX2 __attribute__((target("avx2")))
+
+
+/*
+ * SSE4.1: four points per iteration.
+ */
+
+static inline SSE41 __m128i sse41_random(__m128i n)
+{
+	__m128i t;
+
+	n = _mm_xor_si128(_mm_srli_epi32(n, 13), n);
+
+	t = _mm_mullo_epi32(n, n);
+	t = _mm_mullo_epi32(t, _mm_set1_epi32(60493));
+	t = _mm_add_epi32(t, _mm_set1_epi32(19990303));
+	t = _mm_mullo_epi32(n, t);
+
+	return _mm_add_epi32(t, _mm_set1_epi32(1376312589));
+}
+
+/* odd is all ones in lanes where the lattice corner has odd parity */
+static inline SSE41 __m128i sse41_flipflop(__m128i n, __m128i odd)
+{
+	const __m128i sign = _mm_set1_epi32((int)0x80000000);
+	__m128i keep_odd, keep_even, keep;
+
+	/* Odd:  keep if n > 0x7fffffff
+	 * Even: keep if n < 0x7fffffff */
+	keep_odd = _mm_cmpgt_epi32(_mm_setzero_si128(), n);
+	keep_even = _mm_cmpgt_epi32(_mm_set1_epi32(-1), _mm_xor_si128(n, sign));
+	keep = _mm_blendv_epi8(keep_even, keep_odd, odd);
+
+	/* Otherwise use 0xffffffff - n */
+	return _mm_xor_si128(n, _mm_xor_si128(keep, _mm_set1_epi32(-1)));
+}
+
+static inline SSE41 __m128i sse41_interpolate(__m128i a, __m128i b, __m128i f)
+{
+	const __m128i sign = _mm_set1_epi32((int)0x80000000);
+	__m128i gt, lo, diff, w, even, odd;
+
+	gt = _mm_cmpgt_epi32(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+	lo = _mm_min_epu32(a, b);
+	diff = _mm_sub_epi32(_mm_max_epu32(a, b), lo);
+	w = _mm_blendv_epi8(f, _mm_sub_epi32(
+			_mm_set1_epi32(FIX_MULTIPLE), f), gt);
+
+	/* 32x32 -> 64 bit multiply, for even and odd lanes separately */
+	even = _mm_srli_epi64(_mm_mul_epu32(diff, w), FIX_SHIFT);
+	odd = _mm_mul_epu32(_mm_srli_epi64(diff, 32), _mm_srli_epi64(w, 32));
+	odd = _mm_slli_epi64(_mm_srli_epi64(odd, FIX_SHIFT), 32);
+
+	return _mm_add_epi32(lo, _mm_blend_epi16(even, odd, 0xcc));
+}
+
+/* Look up the fractional parts in the fade curve table */
+static inline SSE41 __m128i sse41_fade(__m128i f, const uint16_t *fade)
+{
+	if (fade == NULL)
+		return f;
+
+	return _mm_setr_epi32(
+			fade[_mm_extract_epi32(f, 0)],
+			fade[_mm_extract_epi32(f, 1)],
+			fade[_mm_extract_epi32(f, 2)],
+			fade[_mm_extract_epi32(f, 3)]);
+}
+
+static inline SSE41 __m128i sse41_noise_at_point(
+		__m128i x, __m128i y, __m128i z,
+		__m128i seed, bool flipflop, const uint16_t *fade)
+{
+	const __m128i mask = _mm_set1_epi32(FIX_MASK);
+	const __m128i one = _mm_set1_epi32(1);
+	__m128i xf, yf, zf;
+	__m128i base, odd, even;
+	__m128i ln, rn, lf, rf;
+	__m128i n, f, t, b;
+
+	xf = sse41_fade(_mm_and_si128(x, mask), fade);
+	yf = sse41_fade(_mm_and_si128(y, mask), fade);
+	zf = sse41_fade(_mm_and_si128(z, mask), fade);
+
+	x = _mm_srli_epi32(x, FIX_SHIFT);
+	y = _mm_srli_epi32(y, FIX_SHIFT);
+	z = _mm_srli_epi32(z, FIX_SHIFT);
+
+	base = _mm_add_epi32(seed, _mm_mullo_epi32(x, _mm_set1_epi32(HASH_X)));
+	base = _mm_add_epi32(base, _mm_mullo_epi32(y, _mm_set1_epi32(HASH_Y)));
+	base = _mm_add_epi32(base, _mm_mullo_epi32(z, _mm_set1_epi32(HASH_Z)));
+
+	/* Corners of top of cube */
+	ln = sse41_random(base);
+	rn = sse41_random(_mm_add_epi32(base, _mm_set1_epi32(HASH_X)));
+	lf = sse41_random(_mm_add_epi32(base, _mm_set1_epi32(HASH_Z)));
+	rf = sse41_random(_mm_add_epi32(base, _mm_set1_epi32(HASH_X + HASH_Z)));
+
+	if (flipflop) {
+		even = _mm_and_si128(_mm_xor_si128(_mm_xor_si128(x, y), z),
+				one);
+		even = _mm_cmpeq_epi32(even, _mm_setzero_si128());
+		odd = _mm_xor_si128(even, _mm_set1_epi32(-1));
+
+		ln = sse41_flipflop(ln, odd);
+		rn = sse41_flipflop(rn, even);
+		lf = sse41_flipflop(lf, even);
+		rf = sse41_flipflop(rf, odd);
+	}
+
+	n = sse41_interpolate(ln, rn, xf);
+	f = sse41_interpolate(lf, rf, xf);
+	t = sse41_interpolate(n, f, zf);
+
+	/* Corners of bottom of cube */
+	base = _mm_add_epi32(base, _mm_set1_epi32(HASH_Y));
+	ln = sse41_random(base);
+	rn = sse41_random(_mm_add_epi32(base, _mm_set1_epi32(HASH_X)));
+	lf = sse41_random(_mm_add_epi32(base, _mm_set1_epi32(HASH_Z)));
+	rf = sse41_random(_mm_add_epi32(base, _mm_set1_epi32(HASH_X + HASH_Z)));
+
+	if (flipflop) {
+		ln = sse41_flipflop(ln, even);
+		rn = sse41_flipflop(rn, odd);
+		lf = sse41_flipflop(lf, odd);
+		rf = sse41_flipflop(rf, even);
+	}
+
+	n = sse41_interpolate(ln, rn, xf);
+	f = sse41_interpolate(lf, rf, xf);
+	b = sse41_interpolate(n, f, zf);
+
+	return sse41_interpolate(t, b, yf);
+}
+
+/* Finest level is just the noise value at the lattice point */
+static inline SSE41 __m128i sse41_lattice_value(__m128i x, __m128i y,
+		__m128i z, __m128i seed_v, bool flipflop)
+{
+	__m128i res, odd;
+
+	res = _mm_add_epi32(seed_v, _mm_mullo_epi32(
+			_mm_srli_epi32(x, FIX_SHIFT),
+			_mm_set1_epi32(HASH_X)));
+	res = _mm_add_epi32(res, _mm_mullo_epi32(
+			_mm_srli_epi32(y, FIX_SHIFT),
+			_mm_set1_epi32(HASH_Y)));
+	res = _mm_add_epi32(res, _mm_mullo_epi32(
+			_mm_srli_epi32(z, FIX_SHIFT),
+			_mm_set1_epi32(HASH_Z)));
+	res = sse41_random(res);
+	if (flipflop) {
+		odd = _mm_srli_epi32(_mm_xor_si128(_mm_xor_si128(
+				x, y), z), FIX_SHIFT);
+		odd = _mm_and_si128(odd, _mm_set1_epi32(1));
+		odd = _mm_cmpeq_epi32(odd, _mm_set1_epi32(1));
+		res = sse41_flipflop(res, odd);
+	}
+
+	return res;
+}
+
+static SSE41 uint32_t noise_sse41_get_values_at_pos(
+		const struct point_3d *p, uint32_t count,
+		uint32_t seed, uint32_t levels, uint32_t first, bool flipflop,
+		const uint16_t *fade, peltar_noise *out)
+{
+	const __m128i seed_v = _mm_set1_epi32(seed * HASH_SEED);
+	const __m128i mean_v = _mm_set1_epi32(noise_octave_mean(levels, first));
+	const uint32_t start = (first > 1) ? first : 1;
+	uint32_t i, level;
+
+	for (i = 0; i + 4 <= count; i += 4) {
+		__m128i x, y, z, res;
+
+		x = _mm_setr_epi32(p[i].x, p[i + 1].x, p[i + 2].x, p[i + 3].x);
+		y = _mm_setr_epi32(p[i].y, p[i + 1].y, p[i + 2].y, p[i + 3].y);
+		z = _mm_setr_epi32(p[i].z, p[i + 1].z, p[i + 2].z, p[i + 3].z);
+
+		if (first == 0) {
+			res = _mm_srl_epi32(sse41_lattice_value(x, y, z,
+					seed_v, flipflop),
+					_mm_cvtsi32_si128(levels));
+		} else {
+			res = mean_v;
+		}
+
+		for (level = start; level < levels; level++) {
+			__m128i shift = _mm_cvtsi32_si128(level);
+			__m128i v = sse41_noise_at_point(
+					_mm_srl_epi32(x, shift),
+					_mm_srl_epi32(y, shift),
+					_mm_srl_epi32(z, shift),
+					seed_v, flipflop, fade);
+
+			res = _mm_add_epi32(res, _mm_srl_epi32(v,
+					_mm_cvtsi32_si128(levels - level)));
+		}
+
+		res = _mm_add_epi32(res, _mm_srl_epi32(res,
+				_mm_cvtsi32_si128(levels)));
+
+		_mm_storeu_si128((__m128i *)(out + i), res);
+	}
+
+	return i;
+}
+
+
+/*
+ * AVX2: eight points per iteration.
+ */
+
+static inline AVX2 __m256i avx2_random(__m256i n)
+{
+	__m256i t;
+
+	n = _mm256_xor_si256(_mm256_srli_epi32(n, 13), n);
+
+	t = _mm256_mullo_epi32(n, n);
+	t = _mm256_mullo_epi32(t, _mm256_set1_epi32(60493));
+	t = _mm256_add_epi32(t, _mm256_set1_epi32(19990303));
+	t = _mm256_mullo_epi32(n, t);
+
+	return _mm256_add_epi32(t, _mm256_set1_epi32(1376312589));
+}
+
+/* odd is all ones in lanes where the lattice corner has odd parity */
+static inline AVX2 __m256i avx2_flipflop(__m256i n, __m256i odd)
+{
+	const __m256i sign = _mm256_set1_epi32((int)0x80000000);
+	__m256i keep_odd, keep_even, keep;
+
+	/* Odd:  keep if n > 0x7fffffff
+	 * Even: keep if n < 0x7fffffff */
+	keep_odd = _mm256_cmpgt_epi32(_mm256_setzero_si256(), n);
+	keep_even = _mm256_cmpgt_epi32(_mm256_set1_epi32(-1),
+			_mm256_xor_si256(n, sign));
+	keep = _mm256_blendv_epi8(keep_even, keep_odd, odd);
+
+	/* Otherwise use 0xffffffff - n */
+	return _mm256_xor_si256(n, _mm256_xor_si256(keep,
+			_mm256_set1_epi32(-1)));
+}
+
+static inline AVX2 __m256i avx2_interpolate(__m256i a, __m256i b, __m256i f)
+{
+	const __m256i sign = _mm256_set1_epi32((int)0x80000000);
+	__m256i gt, lo, diff, w, even, odd;
+
+	gt = _mm256_cmpgt_epi32(_mm256_xor_si256(a, sign),
+			_mm256_xor_si256(b, sign));
+	lo = _mm256_min_epu32(a, b);
+	diff = _mm256_sub_epi32(_mm256_max_epu32(a, b), lo);
+	w = _mm256_blendv_epi8(f, _mm256_sub_epi32(
+			_mm256_set1_epi32(FIX_MULTIPLE), f), gt);
+
+	/* 32x32 -> 64 bit multiply, for even and odd lanes separately */
+	even = _mm256_srli_epi64(_mm256_mul_epu32(diff, w), FIX_SHIFT);
+	odd = _mm256_mul_epu32(_mm256_srli_epi64(diff, 32),
+			_mm256_srli_epi64(w, 32));
+	odd = _mm256_slli_epi64(_mm256_srli_epi64(odd, FIX_SHIFT), 32);
+
+	return _mm256_add_epi32(lo, _mm256_blend_epi32(even, odd, 0xaa));
+}
+
+/* Look up the fractional parts in the fade curve table */
+static inline AVX2 __m256i avx2_fade(__m256i f, const uint16_t *fade)
+{
+	__m256i v;
+
+	if (fade == NULL)
+		return f;
+
+	/* Fetch 32 bits at each 16-bit entry, and discard the next entry */
+	v = _mm256_i32gather_epi32((const int *)fade, f, 2);
+
+	return _mm256_and_si256(v, _mm256_set1_epi32(0xffff));
+}
+
+static inline AVX2 __m256i avx2_noise_at_point(
+		__m256i x, __m256i y, __m256i z,
+		__m256i seed, bool flipflop, const uint16_t *fade)
+{
+	const __m256i mask = _mm256_set1_epi32(FIX_MASK);
+	const __m256i one = _mm256_set1_epi32(1);
+	__m256i xf, yf, zf;
+	__m256i base, odd, even;
+	__m256i ln, rn, lf, rf;
+	__m256i n, f, t, b;
+
+	xf = avx2_fade(_mm256_and_si256(x, mask), fade);
+	yf = avx2_fade(_mm256_and_si256(y, mask), fade);
+	zf = avx2_fade(_mm256_and_si256(z, mask), fade);
+
+	x = _mm256_srli_epi32(x, FIX_SHIFT);
+	y = _mm256_srli_epi32(y, FIX_SHIFT);
+	z = _mm256_srli_epi32(z, FIX_SHIFT);
+
+	base = _mm256_add_epi32(seed, _mm256_mullo_epi32(x,
+			_mm256_set1_epi32(HASH_X)));
+	base = _mm256_add_epi32(base, _mm256_mullo_epi32(y,
+			_mm256_set1_epi32(HASH_Y)));
+	base = _mm256_add_epi32(base, _mm256_mullo_epi32(z,
+			_mm256_set1_epi32(HASH_Z)));
+
+	/* Corners of top of cube */
+	ln = avx2_random(base);
+	rn = avx2_random(_mm256_add_epi32(base, _mm256_set1_epi32(HASH_X)));
+	lf = avx2_random(_mm256_add_epi32(base, _mm256_set1_epi32(HASH_Z)));
+	rf = avx2_random(_mm256_add_epi32(base,
+			_mm256_set1_epi32(HASH_X + HASH_Z)));
+
+	if (flipflop) {
+		even = _mm256_and_si256(_mm256_xor_si256(
+				_mm256_xor_si256(x, y), z), one);
+		even = _mm256_cmpeq_epi32(even, _mm256_setzero_si256());
+		odd = _mm256_xor_si256(even, _mm256_set1_epi32(-1));
+
+		ln = avx2_flipflop(ln, odd);
+		rn = avx2_flipflop(rn, even);
+		lf = avx2_flipflop(lf, even);
+		rf = avx2_flipflop(rf, odd);
+	}
+
+	n = avx2_interpolate(ln, rn, xf);
+	f = avx2_interpolate(lf, rf, xf);
+	t = avx2_interpolate(n, f, zf);
+
+	/* Corners of bottom of cube */
+	base = _mm256_add_epi32(base, _mm256_set1_epi32(HASH_Y));
+	ln = avx2_random(base);
+	rn = avx2_random(_mm256_add_epi32(base, _mm256_set1_epi32(HASH_X)));
+	lf = avx2_random(_mm256_add_epi32(base, _mm256_set1_epi32(HASH_Z)));
+	rf = avx2_random(_mm256_add_epi32(base,
+			_mm256_set1_epi32(HASH_X + HASH_Z)));
+
+	if (flipflop) {
+		ln = avx2_flipflop(ln, even);
+		rn = avx2_flipflop(rn, odd);
+		lf = avx2_flipflop(lf, odd);
+		rf = avx2_flipflop(rf, even);
+	}
+
+	n = avx2_interpolate(ln, rn, xf);
+	f = avx2_interpolate(lf, rf, xf);
+	b = avx2_interpolate(n, f, zf);
+
+	return avx2_interpolate(t, b, yf);
+}
+
+/* Finest level is just the noise value at the lattice point */
+static inline AVX2 __m256i avx2_lattice_value(__m256i x, __m256i y,
+		__m256i z, __m256i seed_v, bool flipflop)
+{
+	__m256i res, odd;
+
+	res = _mm256_add_epi32(seed_v, _mm256_mullo_epi32(
+			_mm256_srli_epi32(x, FIX_SHIFT),
+			_mm256_set1_epi32(HASH_X)));
+	res = _mm256_add_epi32(res, _mm256_mullo_epi32(
+			_mm256_srli_epi32(y, FIX_SHIFT),
+			_mm256_set1_epi32(HASH_Y)));
+	res = _mm256_add_epi32(res, _mm256_mullo_epi32(
+			_mm256_srli_epi32(z, FIX_SHIFT),
+			_mm256_set1_epi32(HASH_Z)));
+	res = avx2_random(res);
+	if (flipflop) {
+		odd = _mm256_srli_epi32(_mm256_xor_si256(
+				_mm256_xor_si256(x, y), z), FIX_SHIFT);
+		odd = _mm256_and_si256(odd, _mm256_set1_epi32(1));
+		odd = _mm256_cmpeq_epi32(odd, _mm256_set1_epi32(1));
+		res = avx2_flipflop(res, odd);
+	}
+
+	return res;
+}
+
+static AVX2 uint32_t noise_avx2_get_values_at_pos(
+		const struct point_3d *p, uint32_t count,
+		uint32_t seed, uint32_t levels, uint32_t first, bool flipflop,
+		const uint16_t *fade, peltar_noise *out)
+{
+	const __m256i seed_v = _mm256_set1_epi32(seed * HASH_SEED);
+	const __m256i mean_v = _mm256_set1_epi32(
+			noise_octave_mean(levels, first));
+	const __m256i index = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+	const uint32_t start = (first > 1) ? first : 1;
+	uint32_t i, level;
+
+	for (i = 0; i + 8 <= count; i += 8) {
+		const int *base = (const int *)(p + i);
+		__m256i x, y, z, res;
+
+		/* Deinterleave the points' x, y and z components */
+		x = _mm256_i32gather_epi32(base + 0, index, 4);
+		y = _mm256_i32gather_epi32(base + 1, index, 4);
+		z = _mm256_i32gather_epi32(base + 2, index, 4);
+
+		if (first == 0) {
+			res = _mm256_srl_epi32(avx2_lattice_value(x, y, z,
+					seed_v, flipflop),
+					_mm_cvtsi32_si128(levels));
+		} else {
+			res = mean_v;
+		}
+
+		for (level = start; level < levels; level++) {
+			__m128i shift = _mm_cvtsi32_si128(level);
+			__m256i v = avx2_noise_at_point(
+					_mm256_srl_epi32(x, shift),
+					_mm256_srl_epi32(y, shift),
+					_mm256_srl_epi32(z, shift),
+					seed_v, flipflop, fade);
+
+			res = _mm256_add_epi32(res, _mm256_srl_epi32(v,
+					_mm_cvtsi32_si128(levels - level)));
+		}
+
+		res = _mm256_add_epi32(res, _mm256_srl_epi32(res,
+				_mm_cvtsi32_si128(levels)));
+
+		_mm256_storeu_si256((__m256i *)(out + i), res);
+	}
+
+	return i;
+}
+
+
+void noise_simd_init(void)
+{
+	cpu_init();
+}
+
+uint32_t noise_simd_get_values_at_pos(
+		const struct point_3d *p, uint32_t count,
+		uint32_t seed, uint32_t levels, uint32_t first, bool flipflop,
+		const uint16_t *fade, peltar_noise *out)
+{
+	switch (cpu_get_simd()) {
+	case CPU_SIMD_AVX2:
+		return noise_avx2_get_values_at_pos(p, count,
+				seed, levels, first, flipflop, fade, out);
+	case CPU_SIMD_SSE41:
+		return noise_sse41_get_values_at_pos(p, count,
+				seed, levels, first, flipflop, fade, out);
+	default:
+		return 0;
+	}
+}
+
+#else
+
+void noise_simd_init(void)
+{
+}
+
+uint32_t noise_simd_get_values_at_pos(
+		const struct point_3d *p, uint32_t count,
+		uint32_t seed, uint32_t levels, uint32_t first, bool flipflop,
+		const uint16_t *fade, peltar_noise *out)
+{
+	(void)(p);
+	(void)(count);
+	(void)(seed);
+	(void)(levels);
+	(void)(first);
+	(void)(flipflop);
+	(void)(fade);
+	(void)(out);
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,50 @@
+
+#ifndef _PELTAR_NOISE_SIMD_H_
+#define _PELTAR_NOISE_SIMD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "noise.h"
+
+struct point_3d;
+
+/*
+ * Vectorised multi-octave noise kernels.
+ *
+ * These give bit-identical results to the scalar noise_get_value_at_pos_*
+ * functions.  Each kernel processes as many points as it can in whole
+ * vectors, and returns the number of points it handled.  The caller must
+ * deal with any remaining points with the scalar code.  If the CPU has no
+ * suitable instructions, zero is returned.
+ *
+ * Octaves below first are not evaluated, and contribute their mean value
+ * instead, as given by noise_octave_mean().
+ *
+ * fade is the fade curve lookup table, with FIX_MULTIPLE + 1 entries, or
+ * NULL for linear interpolation.
+ */
+uint32_t noise_simd_get_values_at_pos(
+		const struct point_3d *p, uint32_t count,
+		uint32_t seed, uint32_t levels, uint32_t first, bool flipflop,
+		const uint16_t *fade, peltar_noise *out);
+
+/* Detect the CPU's instructions now, for every SIMD module, rather than on
+ * first use, so threads that go on to use the kernels needn't race to do
+ * it */
+void noise_simd_init(void);
+
+/* Sum of the mean values of octaves 0 to first - 1 of a levels octave
+ * noise value, before normalisation */
+static inline peltar_noise noise_octave_mean(uint32_t levels, uint32_t first)
+{
+	peltar_noise res = 0;
+	uint32_t level;
+
+	for (level = 0; level < first; level++)
+		res += (UINT64_C(1) << 31) >> (levels - level);
+
+	return res;
+}
+
+#endif
@@ -1,6 +1,10 @@
 
 
+#include <assert.h>
+#include <stddef.h>
+
 #include "noise.h"
+#include "noise-simd.h"
 #include "../lib/types.h"
 
 #define FIX_SHIFT 14
@@ -9,15 +13,84 @@
 
 typedef uint32_t noise_fixed;
 
+static enum noise_fade noise_fade_mode = NOISE_FADE_LINEAR;
+
+/* Fade curve lookup table, or NULL for linear interpolation.  There is an
+ * extra entry so the SIMD kernels can fetch entries with 32-bit gathers. */
+static const uint16_t *noise_fade_lut = NULL;
+static uint16_t noise_fade_table[FIX_MULTIPLE + 1];
+
+/* Slope of the fade curve, with FIX_MULTIPLE meaning 1, or NULL for linear
+ * interpolation (constant slope of 1) */
+static const uint16_t *noise_fade_deriv_lut = NULL;
+static uint16_t noise_fade_deriv_table[FIX_MULTIPLE + 1];
+
+void noise_set_fade(enum noise_fade fade)
+{
+	double t, v, d;
+	uint32_t f;
+
+	noise_fade_mode = fade;
+
+	if (fade == NOISE_FADE_LINEAR) {
+		noise_fade_lut = NULL;
+		noise_fade_deriv_lut = NULL;
+		return;
+	}
+
+	for (f = 0; f <= FIX_MULTIPLE; f++) {
+		t = f / (double)FIX_MULTIPLE;
+
+		if (fade == NOISE_FADE_CUBIC) {
+			v = t * t * (3 - 2 * t);
+			d = 6 * t * (1 - t);
+		} else {
+			v = t * t * t * (t * (t * 6 - 15) + 10);
+			d = 30 * t * t * (t - 1) * (t - 1);
+		}
+
+		noise_fade_table[f] = v * FIX_MULTIPLE + 0.5;
+		noise_fade_deriv_table[f] = d * FIX_MULTIPLE + 0.5;
+	}
+
+	noise_fade_lut = noise_fade_table;
+	noise_fade_deriv_lut = noise_fade_deriv_table;
+}
+
+enum noise_fade noise_get_fade(void)
+{
+	return noise_fade_mode;
+}
+
+uint32_t noise_get_variant(void)
+{
+	uint32_t variant = noise_fade_mode;
+
+#ifdef NOISE_HASH_PERM
+	variant |= 1 << 8;
+#endif
+
+	return variant;
+}
+
+/* Apply the fade curve to the fractional part of a coordinate */
+static inline noise_fixed noise_fade(noise_fixed f)
+{
+	return (noise_fade_lut != NULL) ? noise_fade_lut[f] : f;
+}
+
+/* Get the slope of the fade curve at the fractional part of a coordinate */
+static inline noise_fixed noise_fade_deriv(noise_fixed f)
+{
+	return (noise_fade_deriv_lut != NULL) ?
+			noise_fade_deriv_lut[f] : FIX_MULTIPLE;
+}
+
 static inline peltar_noise noise_random_flipflop(
 		uint32_t x, uint32_t y, uint32_t z,
 		uint32_t seed)
 {
-	/* Note the primeness of constants here is crucial. */
-	peltar_noise n = (1619 * x) + (31337 * y) + (6971 * z) + (1013 * seed);
-	n = (n >> 13) ^ n;
-
-	n = n * (n * n * 60493 + 19990303) + 1376312589;
+	peltar_noise n = noise_random(x, y, z, seed);
 
 	/* Flip-flop the result so that adjacent values are always on opposite
 	 * sides of the middle possible value. (This ensures signal has fairly
@@ -42,18 +115,17 @@ static inline peltar_noise interpolate(peltar_noise a, peltar_noise b,
 {
 	uint64_t difference;
 
-	/* TODO: Is this smoothing worth the extra time? */
-//	f = (((f*f) >> FIX_SHIFT) * (3 * FIX_MULTIPLE - (2 * f))) >> FIX_SHIFT;
+	/* Written to avoid unpredictable branches.  Equivalent to:
+	 *
+	 *   a > b ? b + ((a - b) * (FIX_MULTIPLE - f)) / FIX_MULTIPLE
+	 *         : a + ((b - a) * f) / FIX_MULTIPLE
+	 */
+	peltar_noise low = (a > b) ? b : a;
+	noise_fixed weight = (a > b) ? FIX_MULTIPLE - f : f;
 
-	if (a > b) {
-		difference = a - b;
+	difference = ((a > b) ? a : b) - low;
 
-		return b + ((difference * (FIX_MULTIPLE - f)) / FIX_MULTIPLE);
-	} else {
-		difference = b - a;
-
-		return a + ((difference * f) / FIX_MULTIPLE);
-	}
+	return low + ((difference * weight) >> FIX_SHIFT);
 }
 
 
@@ -81,6 +153,10 @@ static inline peltar_noise noise_get_noise_at_point(
 	zf = z & FIX_MASK;
 	z >>= FIX_SHIFT;
 
+	xf = noise_fade(xf);
+	yf = noise_fade(yf);
+	zf = noise_fade(zf);
+
 	/* Get noise values for corners of top of cube */
 	ln = noise_random(x,     y,     z,     seed);
 	rn = noise_random(x + 1, y,     z,     seed);
@@ -131,6 +207,10 @@ static inline peltar_noise noise_get_noise_at_point_flipflop(
 	zf = z & FIX_MASK;
 	z >>= FIX_SHIFT;
 
+	xf = noise_fade(xf);
+	yf = noise_fade(yf);
+	zf = noise_fade(zf);
+
 	/* Get noise values for corners of top of cube */
 	ln = noise_random_flipflop(x,     y,     z,     seed);
 	rn = noise_random_flipflop(x + 1, y,     z,     seed);
@@ -174,6 +254,9 @@ static inline peltar_noise noise_get_noise_at_point_2d(
 	yf = y & FIX_MASK;
 	y >>= FIX_SHIFT;
 
+	xf = noise_fade(xf);
+	yf = noise_fade(yf);
+
 	/* Get noise values for corners of square */
 	ln = noise_random(x,     y,     200, seed);
 	rn = noise_random(x + 1, y,     200, seed);
@@ -187,21 +270,182 @@ static inline peltar_noise noise_get_noise_at_point_2d(
 }
 
 
+/* Evaluate a single octave of noise at a point */
+static inline peltar_noise noise_octave_standard(struct point_3d p,
+		uint32_t level, uint32_t seed)
+{
+	return noise_get_noise_at_point(p.x >> level, p.y >> level,
+			p.z >> level, seed);
+}
+
+static inline peltar_noise noise_octave_flipflop(struct point_3d p,
+		uint32_t level, uint32_t seed)
+{
+	return noise_get_noise_at_point_flipflop(p.x >> level, p.y >> level,
+			p.z >> level, seed);
+}
+
+static inline peltar_noise noise_octave_2d(struct point_3d p,
+		uint32_t level, uint32_t seed)
+{
+	return noise_get_noise_at_point_2d(p.x >> level, p.y >> level, seed);
+}
+
+
+/*
+ * Unrolled octave loops
+ *
+ * The octave sums are generated for each level count up to NOISE_UNROLL_MAX
+ * so that the octave count, and with it each octave's weighting shift, is
+ * a compile time constant.  Octaves at or beyond the level count are folded
+ * away.  Other level counts use the generic loops further down.
+ */
+#define NOISE_UNROLL_MAX 12
+
+/* Add octave l of an n octave sum to res, if it's wanted */
+#define NOISE_OCTAVE(res, octave, p, seed, n, l, start) \
+	res += ((l) < (n)) ? ((l) >= (start) ? \
+			octave(p, l, seed) >> ((n) - (l)) : 0) : 0
+
+#define NOISE_OCTAVES(res, octave, p, seed, n, start) \
+	do { \
+		NOISE_OCTAVE(res, octave, p, seed, n,  0, start); \
+		NOISE_OCTAVE(res, octave, p, seed, n,  1, start); \
+		NOISE_OCTAVE(res, octave, p, seed, n,  2, start); \
+		NOISE_OCTAVE(res, octave, p, seed, n,  3, start); \
+		NOISE_OCTAVE(res, octave, p, seed, n,  4, start); \
+		NOISE_OCTAVE(res, octave, p, seed, n,  5, start); \
+		NOISE_OCTAVE(res, octave, p, seed, n,  6, start); \
+		NOISE_OCTAVE(res, octave, p, seed, n,  7, start); \
+		NOISE_OCTAVE(res, octave, p, seed, n,  8, start); \
+		NOISE_OCTAVE(res, octave, p, seed, n,  9, start); \
+		NOISE_OCTAVE(res, octave, p, seed, n, 10, start); \
+		NOISE_OCTAVE(res, octave, p, seed, n, 11, start); \
+	} while (0)
+
+/* Full noise values: level 0 is a single lattice value */
+#define NOISE_UNROLL_FULL(name, random, octave, n) \
+	static peltar_noise noise_##name##_##n(struct point_3d p, \
+			uint32_t seed) \
+	{ \
+		peltar_noise res; \
+		\
+		res = random(p.x >> FIX_SHIFT, p.y >> FIX_SHIFT, \
+				p.z >> FIX_SHIFT, seed) >> (n); \
+		NOISE_OCTAVES(res, octave, p, seed, n, 1); \
+		\
+		return res + (res >> (n)); \
+	}
+
+/* Noise values made from octaves start to n-1 */
+#define NOISE_UNROLL_RANGE(name, octave, n) \
+	static peltar_noise noise_##name##_##n(struct point_3d p, \
+			uint32_t seed, uint32_t start) \
+	{ \
+		peltar_noise res = 0; \
+		\
+		NOISE_OCTAVES(res, octave, p, seed, n, start); \
+		\
+		return res + (res >> ((n) - start)); \
+	}
+
+/* Level of detail noise values: octaves below first are replaced by
+ * their mean */
+#define NOISE_UNROLL_LOD(name, octave, n) \
+	static peltar_noise noise_##name##_##n(struct point_3d p, \
+			uint32_t seed, uint32_t first) \
+	{ \
+		peltar_noise res = noise_octave_mean(n, first); \
+		\
+		NOISE_OCTAVES(res, octave, p, seed, n, first); \
+		\
+		return res + (res >> (n)); \
+	}
+
+#define NOISE_UNROLL(n) \
+	NOISE_UNROLL_FULL(standard, noise_random, \
+			noise_octave_standard, n) \
+	NOISE_UNROLL_FULL(flipflop, noise_random_flipflop, \
+			noise_octave_flipflop, n) \
+	NOISE_UNROLL_RANGE(standard_range, noise_octave_standard, n) \
+	NOISE_UNROLL_RANGE(flipflop_range, noise_octave_flipflop, n) \
+	NOISE_UNROLL_RANGE(standard_range_2d, noise_octave_2d, n) \
+	NOISE_UNROLL_LOD(standard_lod, noise_octave_standard, n) \
+	NOISE_UNROLL_LOD(flipflop_lod, noise_octave_flipflop, n)
+
+NOISE_UNROLL(1)
+NOISE_UNROLL(2)
+NOISE_UNROLL(3)
+NOISE_UNROLL(4)
+NOISE_UNROLL(5)
+NOISE_UNROLL(6)
+NOISE_UNROLL(7)
+NOISE_UNROLL(8)
+NOISE_UNROLL(9)
+NOISE_UNROLL(10)
+NOISE_UNROLL(11)
+NOISE_UNROLL(12)
+
+typedef peltar_noise (*noise_full_fn)(struct point_3d p, uint32_t seed);
+typedef peltar_noise (*noise_range_fn)(struct point_3d p, uint32_t seed,
+		uint32_t start);
+
+/* Unrolled noise functions, indexed by level count */
+static const struct noise_unrolled {
+	noise_full_fn standard;
+	noise_full_fn flipflop;
+	noise_range_fn standard_range;
+	noise_range_fn flipflop_range;
+	noise_range_fn standard_range_2d;
+	noise_range_fn standard_lod;
+	noise_range_fn flipflop_lod;
+} noise_unrolled[NOISE_UNROLL_MAX + 1] = {
+#define NOISE_UNROLLED_ENTRY(n) \
+	[n] = { \
+		.standard          = noise_standard_##n, \
+		.flipflop          = noise_flipflop_##n, \
+		.standard_range    = noise_standard_range_##n, \
+		.flipflop_range    = noise_flipflop_range_##n, \
+		.standard_range_2d = noise_standard_range_2d_##n, \
+		.standard_lod      = noise_standard_lod_##n, \
+		.flipflop_lod      = noise_flipflop_lod_##n, \
+	}
+	NOISE_UNROLLED_ENTRY(1),
+	NOISE_UNROLLED_ENTRY(2),
+	NOISE_UNROLLED_ENTRY(3),
+	NOISE_UNROLLED_ENTRY(4),
+	NOISE_UNROLLED_ENTRY(5),
+	NOISE_UNROLLED_ENTRY(6),
+	NOISE_UNROLLED_ENTRY(7),
+	NOISE_UNROLLED_ENTRY(8),
+	NOISE_UNROLLED_ENTRY(9),
+	NOISE_UNROLLED_ENTRY(10),
+	NOISE_UNROLLED_ENTRY(11),
+	NOISE_UNROLLED_ENTRY(12),
+#undef NOISE_UNROLLED_ENTRY
+};
+
+static inline bool noise_is_unrolled(uint32_t levels)
+{
+	return levels > 0 && levels <= NOISE_UNROLL_MAX;
+}
+
+
 peltar_noise noise_get_value_at_pos_standard(struct point_3d p,
 		uint32_t seed, uint32_t levels)
 {
 	peltar_noise res;
 	uint32_t level;
 
+	if (noise_is_unrolled(levels))
+		return noise_unrolled[levels].standard(p, seed);
+
 	res = noise_random(p.x >> FIX_SHIFT, p.y >> FIX_SHIFT,
 			p.z >> FIX_SHIFT, seed) >> levels;
 
 	for (level = 1; level < levels; level++) {
-		res += noise_get_noise_at_point(
-				p.x >> level,
-				p.y >> level,
-				p.z >> level,
-				seed) >> (levels - level);
+		res += noise_octave_standard(p, level, seed) >>
+				(levels - level);
 	}
 
 	return res + (res >> levels);
@@ -214,33 +458,152 @@ peltar_noise noise_get_value_at_pos_flipflop(struct point_3d p,
 	peltar_noise res;
 	uint32_t level;
 
+	if (noise_is_unrolled(levels))
+		return noise_unrolled[levels].flipflop(p, seed);
+
 	res = noise_random_flipflop(p.x >> FIX_SHIFT, p.y >> FIX_SHIFT,
 			p.z >> FIX_SHIFT, seed) >> levels;
 
 	for (level = 1; level < levels; level++) {
-		res += noise_get_noise_at_point_flipflop(
-				p.x >> level,
-				p.y >> level,
-				p.z >> level,
-				seed) >> (levels - level);
+		res += noise_octave_flipflop(p, level, seed) >>
+				(levels - level);
 	}
 
 	return res + (res >> levels);
 }
 
 
+uint32_t noise_octave_limit(uint32_t levels, uint32_t footprint,
+		uint32_t bits)
+{
+	uint32_t first = 0;
+
+	/* Octave lattice cells smaller than the footprint would only alias */
+	while (first < levels && ((uint64_t)FIX_MULTIPLE << first) < footprint)
+		first++;
+
+	/* Octaves 0 to levels - bits - 1 sum to less than one LSB of the
+	 * top bits of the value */
+	if (levels > bits && levels - bits > first)
+		first = levels - bits;
+
+	/* Always evaluate the coarsest octave */
+	if (first >= levels)
+		first = (levels > 0) ? levels - 1 : 0;
+
+	return first;
+}
+
+
+static inline peltar_noise noise_get_value_at_pos_lod(enum noise_type type,
+		struct point_3d p, uint32_t seed, uint32_t levels,
+		uint32_t first)
+{
+	peltar_noise res = noise_octave_mean(levels, first);
+	uint32_t level;
+
+	if (noise_is_unrolled(levels)) {
+		if (type == NOISE_FLIPFLOP)
+			return noise_unrolled[levels].flipflop_lod(p, seed,
+					first);
+		return noise_unrolled[levels].standard_lod(p, seed, first);
+	}
+
+	for (level = first; level < levels; level++) {
+		if (type == NOISE_FLIPFLOP)
+			res += noise_octave_flipflop(p, level, seed) >>
+					(levels - level);
+		else
+			res += noise_octave_standard(p, level, seed) >>
+					(levels - level);
+	}
+
+	return res + (res >> levels);
+}
+
+
+peltar_noise noise_get_value_at_pos_standard_lod(struct point_3d p,
+		uint32_t seed, uint32_t levels, uint32_t first)
+{
+	if (first == 0)
+		return noise_get_value_at_pos_standard(p, seed, levels);
+
+	return noise_get_value_at_pos_lod(NOISE_STANDARD, p, seed,
+			levels, first);
+}
+
+
+peltar_noise noise_get_value_at_pos_flipflop_lod(struct point_3d p,
+		uint32_t seed, uint32_t levels, uint32_t first)
+{
+	if (first == 0)
+		return noise_get_value_at_pos_flipflop(p, seed, levels);
+
+	return noise_get_value_at_pos_lod(NOISE_FLIPFLOP, p, seed,
+			levels, first);
+}
+
+
+void noise_get_values_at_pos_standard_lod(const struct point_3d *p,
+		uint32_t count, uint32_t seed, uint32_t levels,
+		uint32_t first, peltar_noise *out)
+{
+	uint32_t i;
+
+	i = noise_simd_get_values_at_pos(p, count, seed, levels, first,
+			false, noise_fade_lut, out);
+
+	for (; i < count; i++) {
+		out[i] = noise_get_value_at_pos_standard_lod(p[i], seed,
+				levels, first);
+	}
+}
+
+
+void noise_get_values_at_pos_flipflop_lod(const struct point_3d *p,
+		uint32_t count, uint32_t seed, uint32_t levels,
+		uint32_t first, peltar_noise *out)
+{
+	uint32_t i;
+
+	i = noise_simd_get_values_at_pos(p, count, seed, levels, first,
+			true, noise_fade_lut, out);
+
+	for (; i < count; i++) {
+		out[i] = noise_get_value_at_pos_flipflop_lod(p[i], seed,
+				levels, first);
+	}
+}
+
+
+void noise_get_values_at_pos_standard(const struct point_3d *p,
+		uint32_t count, uint32_t seed, uint32_t levels,
+		peltar_noise *out)
+{
+	noise_get_values_at_pos_standard_lod(p, count, seed, levels, 0, out);
+}
+
+
+void noise_get_values_at_pos_flipflop(const struct point_3d *p,
+		uint32_t count, uint32_t seed, uint32_t levels,
+		peltar_noise *out)
+{
+	noise_get_values_at_pos_flipflop_lod(p, count, seed, levels, 0, out);
+}
+
+
 peltar_noise noise_get_value_at_pos_standard_range(struct point_3d p,
 		uint32_t seed, uint32_t levels, uint32_t start)
 {
 	peltar_noise res = 0;
 	uint32_t level;
 
+	if (noise_is_unrolled(levels))
+		return noise_unrolled[levels].standard_range(p, seed, start);
+
 	for (level = start; level < levels; level++) {
-		res += noise_get_noise_at_point(
-				p.x >> level,
-				p.y >> level,
-				p.z >> level,
-				seed) >> (levels - level);
+		res += noise_octave_standard(p, level, seed) >>
+				(levels - level);
 	}
 
 	return res + (res >> (levels - start));
@@ -253,12 +616,12 @@ peltar_noise noise_get_value_at_pos_flipflop_range(struct point_3d p,
 	peltar_noise res = 0;
 	uint32_t level;
 
+	if (noise_is_unrolled(levels))
+		return noise_unrolled[levels].flipflop_range(p, seed, start);
+
 	for (level = start; level < levels; level++) {
-		res += noise_get_noise_at_point_flipflop(
-				p.x >> level,
-				p.y >> level,
-				p.z >> level,
-				seed) >> (levels - level);
+		res += noise_octave_flipflop(p, level, seed) >>
+				(levels - level);
 	}
 
 	return res + (res >> (levels - start));
@@ -271,13 +634,485 @@ peltar_noise noise_get_value_at_pos_standard_range_2d(struct point_3d p,
 	peltar_noise res = 0;
 	uint32_t level;
 
+	if (noise_is_unrolled(levels))
+		return noise_unrolled[levels].standard_range_2d(p, seed, start);
+
 	for (level = start; level < levels; level++) {
-		res += noise_get_noise_at_point_2d(
+		res += noise_octave_2d(p, level, seed) >> (levels - level);
+	}
+
+	return res + (res >> (levels - start));
+}
+
+
+void noise_row_init_range(struct noise_row *row, enum noise_type type,
+		uint32_t seed, uint32_t levels, uint32_t start)
+{
+	uint32_t level;
+
+	assert(levels <= NOISE_ROW_LEVELS_MAX);
+
+	row->type = type;
+	row->range = true;
+	row->seed = seed;
+	row->levels = levels;
+	row->start = start;
+	row->first = 0;
+
+	/* Lattice coordinates are at most 18 bits, so this never matches */
+	for (level = 0; level < levels; level++) {
+		row->cell[level].x = UINT32_MAX;
+		row->cell[level].y = UINT32_MAX;
+		row->cell[level].z = UINT32_MAX;
+	}
+}
+
+
+void noise_row_init(struct noise_row *row, enum noise_type type,
+		uint32_t seed, uint32_t levels)
+{
+	noise_row_init_range(row, type, seed, levels, 0);
+	row->range = false;
+}
+
+
+void noise_row_init_lod(struct noise_row *row, enum noise_type type,
+		uint32_t seed, uint32_t levels, uint32_t first)
+{
+	noise_row_init(row, type, seed, levels);
+	row->first = first;
+}
+
+
+static inline peltar_noise noise_row_random(enum noise_type type,
+		uint32_t x, uint32_t y, uint32_t z, uint32_t seed)
+{
+	switch (type) {
+	case NOISE_FLIPFLOP:
+		return noise_random_flipflop(x, y, z, seed);
+	case NOISE_STANDARD_2D:
+		return noise_random(x, y, 200, seed);
+	default:
+		return noise_random(x, y, z, seed);
+	}
+}
+
+
+/* Get the noise values at the corners of the lattice cell at x, y, z */
+static inline void noise_cell_hash(peltar_noise corner[8],
+		enum noise_type type, uint32_t x, uint32_t y, uint32_t z,
+		uint32_t seed)
+{
+	if (type == NOISE_STANDARD_2D) {
+		corner[0] = noise_random(x,     y,     200, seed);
+		corner[1] = noise_random(x + 1, y,     200, seed);
+		corner[2] = noise_random(x,     y + 1, 200, seed);
+		corner[3] = noise_random(x + 1, y + 1, 200, seed);
+		return;
+	}
+
+	corner[0] = noise_row_random(type, x,     y,     z,     seed);
+	corner[1] = noise_row_random(type, x + 1, y,     z,     seed);
+	corner[2] = noise_row_random(type, x,     y,     z + 1, seed);
+	corner[3] = noise_row_random(type, x + 1, y,     z + 1, seed);
+	corner[4] = noise_row_random(type, x,     y + 1, z,     seed);
+	corner[5] = noise_row_random(type, x + 1, y + 1, z,     seed);
+	corner[6] = noise_row_random(type, x,     y + 1, z + 1, seed);
+	corner[7] = noise_row_random(type, x + 1, y + 1, z + 1, seed);
+}
+
+
+/* Interpolate corner values, in the same order as noise_get_noise_at_point*
+ * so the results are identical. */
+static inline peltar_noise noise_cell_interpolate(
+		const peltar_noise corner[8], enum noise_type type,
+		noise_fixed xf, noise_fixed yf, noise_fixed zf)
+{
+	peltar_noise n, f, t, b;
+
+	if (type == NOISE_STANDARD_2D) {
+		n = interpolate(corner[0], corner[1], xf);
+		f = interpolate(corner[2], corner[3], xf);
+
+		return interpolate(n, f, yf);
+	}
+
+	n = interpolate(corner[0], corner[1], xf);
+	f = interpolate(corner[2], corner[3], xf);
+	t = interpolate(n, f, zf);
+
+	n = interpolate(corner[4], corner[5], xf);
+	f = interpolate(corner[6], corner[7], xf);
+	b = interpolate(n, f, zf);
+
+	return interpolate(t, b, yf);
+}
+
+
+/* Equivalent to noise_get_noise_at_point*(), using cached corners */
+static inline peltar_noise noise_row_get_noise_at_point(
+		struct noise_row *row, struct noise_row_cell *c,
+		uint32_t x, uint32_t y, uint32_t z)
+{
+	uint32_t xi = x >> FIX_SHIFT;
+	uint32_t yi = y >> FIX_SHIFT;
+	uint32_t zi = (row->type == NOISE_STANDARD_2D) ? 0 : z >> FIX_SHIFT;
+
+	/* Rehash the corners of the cell, if the lattice point has moved */
+	if (xi != c->x || yi != c->y || zi != c->z) {
+		c->x = xi;
+		c->y = yi;
+		c->z = zi;
+		noise_cell_hash(c->corner, row->type, xi, yi, zi, row->seed);
+	}
+
+	return noise_cell_interpolate(c->corner, row->type,
+			noise_fade(x & FIX_MASK),
+			noise_fade(y & FIX_MASK),
+			noise_fade(z & FIX_MASK));
+}
+
+
+peltar_noise noise_row_get_value(struct noise_row *row, struct point_3d p)
+{
+	peltar_noise res = 0;
+	uint32_t level = row->start;
+
+	if (!row->range && row->first > 0) {
+		res = noise_octave_mean(row->levels, row->first);
+		level = row->first;
+	} else if (!row->range) {
+		/* Finest level is just the noise value at the lattice point,
+		 * which changes at every point, so there's nothing to cache */
+		res = noise_row_random(row->type, p.x >> FIX_SHIFT,
+				p.y >> FIX_SHIFT, p.z >> FIX_SHIFT,
+				row->seed) >> row->levels;
+		level = 1;
+	}
+
+	for (; level < row->levels; level++) {
+		res += noise_row_get_noise_at_point(row, &row->cell[level],
 				p.x >> level,
 				p.y >> level,
-				seed) >> (levels - level);
+				p.z >> level) >> (row->levels - level);
 	}
 
-	return res + (res >> (levels - start));
+	if (!row->range)
+		return res + (res >> row->levels);
+
+	return res + (res >> (row->levels - row->start));
+}
+
+
+/* Evaluate one octave of a 2d noise field along a row, adding each value's
+ * weighted contribution to out */
+static inline void noise_row_2d_octave(const struct noise_field_2d *field,
+		uint32_t level, uint32_t x, uint32_t step, uint32_t yi,
+		noise_fixed yf, uint32_t width, peltar_noise *out)
+{
+	uint32_t shift = field->levels - level;
+	uint32_t cell = (x >> level) >> FIX_SHIFT;
+	uint32_t prev;
+	peltar_noise ln, rn, lf, rf;
+	uint32_t i = 0;
+
+	ln = noise_random(cell,     yi,     200, field->seed);
+	lf = noise_random(cell,     yi + 1, 200, field->seed);
+
+	while (i < width) {
+		/* Points up to the start of the next cell along all
+		 * interpolate between the same corners */
+		uint64_t next = (uint64_t)(cell + 1) << (FIX_SHIFT + level);
+		uint32_t end = (step == 0) ? width :
+				i + (next - x + step - 1) / step;
+		peltar_noise n_low, n_diff, f_low, f_diff;
+		bool n_flip, f_flip;
+
+		if (end > width)
+			end = width;
+
+		rn = noise_random(cell + 1, yi,     200, field->seed);
+		rf = noise_random(cell + 1, yi + 1, 200, field->seed);
+
+		n_low  = (ln > rn) ? rn : ln;
+		n_diff = ((ln > rn) ? ln : rn) - n_low;
+		n_flip = ln > rn;
+		f_low  = (lf > rf) ? rf : lf;
+		f_diff = ((lf > rf) ? lf : rf) - f_low;
+		f_flip = lf > rf;
+
+		for (; i < end; i++, x += step) {
+			noise_fixed xf = noise_fade((x >> level) & FIX_MASK);
+			peltar_noise n, f;
+
+			n = n_low + (((uint64_t)n_diff * (n_flip ?
+					FIX_MULTIPLE - xf : xf)) >> FIX_SHIFT);
+			f = f_low + (((uint64_t)f_diff * (f_flip ?
+					FIX_MULTIPLE - xf : xf)) >> FIX_SHIFT);
+
+			out[i] += interpolate(n, f, yf) >> shift;
+		}
+
+		/* If the step was into the next cell along, its left corners
+		 * are the old right corners */
+		prev = cell;
+		cell = (x >> level) >> FIX_SHIFT;
+		if (cell == prev + 1) {
+			ln = rn;
+			lf = rf;
+		} else {
+			ln = noise_random(cell, yi,     200, field->seed);
+			lf = noise_random(cell, yi + 1, 200, field->seed);
+		}
+	}
+}
+
+
+void noise_get_row_2d(const struct noise_field_2d *field, uint32_t count,
+		uint32_t x, uint32_t y, uint32_t step, uint32_t width,
+		peltar_noise *out)
+{
+	uint32_t levels = 0;
+	uint32_t start = UINT32_MAX;
+	uint32_t level, i, j;
+
+	assert(count <= NOISE_MULTI_MAX);
+
+	for (j = 0; j < count; j++) {
+		if (field[j].levels > levels)
+			levels = field[j].levels;
+		if (field[j].start < start)
+			start = field[j].start;
+
+		for (i = 0; i < width; i++)
+			out[j * width + i] = 0;
+	}
+
+	for (level = start; level < levels; level++) {
+		/* The row's lattice row and vertical fractional position
+		 * are shared by every point and field at this octave */
+		uint32_t yl = y >> level;
+		uint32_t yi = yl >> FIX_SHIFT;
+		noise_fixed yf = noise_fade(yl & FIX_MASK);
+
+		for (j = 0; j < count; j++) {
+			if (level < field[j].start || level >= field[j].levels)
+				continue;
+
+			noise_row_2d_octave(&field[j], level, x, step,
+					yi, yf, width, out + j * width);
+		}
+	}
+
+	for (j = 0; j < count; j++) {
+		uint32_t shift = field[j].levels - field[j].start;
+
+		for (i = 0; i < width; i++)
+			out[j * width + i] += out[j * width + i] >> shift;
+	}
+}
+
+
+void noise_get_values_at_pos_multi(struct point_3d p,
+		const struct noise_request *req, uint32_t count,
+		peltar_noise *out)
+{
+	peltar_noise raw[NOISE_MULTI_MAX]; /* Current octave's noise values */
+	uint32_t twin[NOISE_MULTI_MAX]; /* Earlier request with same field */
+	uint32_t levels = 0;
+	uint32_t start = UINT32_MAX;
+	uint32_t level, i, j;
+
+	assert(count <= NOISE_MULTI_MAX);
+
+	/* Requests for the same type of noise with the same seed get the
+	 * same values at every octave they have in common */
+	for (i = 0; i < count; i++) {
+		assert(req[i].type != NOISE_STANDARD_2D);
+
+		twin[i] = i;
+		for (j = 0; j < i; j++) {
+			if (req[j].type == req[i].type &&
+					req[j].seed == req[i].seed) {
+				twin[i] = twin[j];
+				break;
+			}
+		}
+
+		if (req[i].levels > levels)
+			levels = req[i].levels;
+		if (req[i].first < start)
+			start = req[i].first;
+	}
+
+	/* Finest level is just the noise value at the lattice point */
+	for (i = 0; i < count; i++) {
+		if (req[i].first > 0) {
+			/* Octaves below first are culled */
+			out[i] = noise_octave_mean(req[i].levels,
+					req[i].first);
+			continue;
+		}
+
+		if (twin[i] != i && req[twin[i]].first == 0) {
+			raw[i] = raw[twin[i]];
+		} else {
+			raw[i] = noise_row_random(req[i].type,
+					p.x >> FIX_SHIFT,
+					p.y >> FIX_SHIFT,
+					p.z >> FIX_SHIFT,
+					req[i].seed);
+		}
+		out[i] = raw[i] >> req[i].levels;
+	}
+
+	for (level = (start > 1) ? start : 1; level < levels; level++) {
+		/* Lattice cell and fractional position are shared by all
+		 * the requests at this octave */
+		uint32_t x = p.x >> level;
+		uint32_t y = p.y >> level;
+		uint32_t z = p.z >> level;
+		noise_fixed xf = noise_fade(x & FIX_MASK);
+		noise_fixed yf = noise_fade(y & FIX_MASK);
+		noise_fixed zf = noise_fade(z & FIX_MASK);
+
+		x >>= FIX_SHIFT;
+		y >>= FIX_SHIFT;
+		z >>= FIX_SHIFT;
+
+		for (i = 0; i < count; i++) {
+			peltar_noise corner[8];
+
+			if (level >= req[i].levels || level < req[i].first)
+				continue;
+
+			if (twin[i] != i && level < req[twin[i]].levels &&
+					level >= req[twin[i]].first) {
+				raw[i] = raw[twin[i]];
+			} else {
+				noise_cell_hash(corner, req[i].type,
+						x, y, z, req[i].seed);
+				raw[i] = noise_cell_interpolate(corner,
+						req[i].type, xf, yf, zf);
+			}
+
+			out[i] += raw[i] >> (req[i].levels - level);
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		out[i] += out[i] >> req[i].levels;
+	}
+}
+
+
+/* Signed linear interpolation, for noise gradients */
+static inline int64_t interpolate_signed(int64_t a, int64_t b, noise_fixed f)
+{
+	return a + (((b - a) * (int64_t)f) / FIX_MULTIPLE);
 }
 
+
+/* Get the gradient of the trilinear interpolation of a cell's corners, in
+ * noise units per lattice cell.  xd, yd and zd are the slopes of the fade
+ * curve at the point. */
+static inline void noise_cell_gradient(const peltar_noise corner[8],
+		noise_fixed xf, noise_fixed yf, noise_fixed zf,
+		noise_fixed xd, noise_fixed yd, noise_fixed zd,
+		int64_t grad[3])
+{
+	int64_t c[8];
+	int64_t n, f, t, b;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		c[i] = corner[i];
+
+	/* Differences along x, interpolated over z and y */
+	t = interpolate_signed(c[1] - c[0], c[3] - c[2], zf);
+	b = interpolate_signed(c[5] - c[4], c[7] - c[6], zf);
+	grad[0] = (interpolate_signed(t, b, yf) * xd) / FIX_MULTIPLE;
+
+	/* Differences along z, interpolated over x and y */
+	t = interpolate_signed(c[2] - c[0], c[3] - c[1], xf);
+	b = interpolate_signed(c[6] - c[4], c[7] - c[5], xf);
+	grad[2] = (interpolate_signed(t, b, yf) * zd) / FIX_MULTIPLE;
+
+	/* Difference between top and bottom faces */
+	n = interpolate_signed(c[0], c[1], xf);
+	f = interpolate_signed(c[2], c[3], xf);
+	t = interpolate_signed(n, f, zf);
+
+	n = interpolate_signed(c[4], c[5], xf);
+	f = interpolate_signed(c[6], c[7], xf);
+	b = interpolate_signed(n, f, zf);
+
+	grad[1] = ((b - t) * yd) / FIX_MULTIPLE;
+}
+
+
+static peltar_noise noise_get_value_at_pos_deriv(enum noise_type type,
+		struct point_3d p, uint32_t seed, uint32_t levels,
+		struct noise_gradient *grad)
+{
+	int64_t sum[3] = { 0, 0, 0 };
+	peltar_noise res;
+	uint32_t level;
+
+	/* Finest level is just the noise value at the lattice point, which
+	 * is constant across the texel, so has no gradient */
+	res = noise_row_random(type, p.x >> FIX_SHIFT, p.y >> FIX_SHIFT,
+			p.z >> FIX_SHIFT, seed) >> levels;
+
+	for (level = 1; level < levels; level++) {
+		peltar_noise corner[8];
+		int64_t g[3];
+		uint32_t x = p.x >> level;
+		uint32_t y = p.y >> level;
+		uint32_t z = p.z >> level;
+		noise_fixed xf = x & FIX_MASK;
+		noise_fixed yf = y & FIX_MASK;
+		noise_fixed zf = z & FIX_MASK;
+
+		noise_cell_hash(corner, type, x >> FIX_SHIFT, y >> FIX_SHIFT,
+				z >> FIX_SHIFT, seed);
+
+		res += noise_cell_interpolate(corner, type,
+				noise_fade(xf), noise_fade(yf),
+				noise_fade(zf)) >> (levels - level);
+
+		noise_cell_gradient(corner,
+				noise_fade(xf), noise_fade(yf), noise_fade(zf),
+				noise_fade_deriv(xf), noise_fade_deriv(yf),
+				noise_fade_deriv(zf), g);
+
+		/* An octave's lattice cells are 1 << level units across, and
+		 * its weight is 1 >> (levels - level), so every octave's
+		 * gradient is scaled down by levels */
+		sum[0] += g[0];
+		sum[1] += g[1];
+		sum[2] += g[2];
+	}
+
+	grad->x = sum[0] / ((int64_t)1 << levels);
+	grad->y = sum[1] / ((int64_t)1 << levels);
+	grad->z = sum[2] / ((int64_t)1 << levels);
+
+	return res + (res >> levels);
+}
+
+
+peltar_noise noise_get_value_at_pos_standard_deriv(struct point_3d p,
+		uint32_t seed, uint32_t levels, struct noise_gradient *grad)
+{
+	return noise_get_value_at_pos_deriv(NOISE_STANDARD, p, seed, levels,
+			grad);
+}
+
+
+peltar_noise noise_get_value_at_pos_flipflop_deriv(struct point_3d p,
+		uint32_t seed, uint32_t levels, struct noise_gradient *grad)
+{
+	return noise_get_value_at_pos_deriv(NOISE_FLIPFLOP, p, seed, levels,
+			grad);
+}
@@ -2,14 +2,85 @@
 #ifndef _PELTAR_NOISE_H_
 #define _PELTAR_NOISE_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef uint32_t peltar_noise;
 
 struct point_3d;
 
-static inline peltar_noise noise_random(uint32_t x, uint32_t y, uint32_t z,
-		uint32_t seed)
+/* Curve used to smooth interpolation between lattice points */
+enum noise_fade {
+	NOISE_FADE_LINEAR,  /* No smoothing */
+	NOISE_FADE_CUBIC,   /* 3f^2 - 2f^3 */
+	NOISE_FADE_QUINTIC, /* 6f^5 - 15f^4 + 10f^3 */
+};
+
+/* Maximum number of octaves a noise row walker can evaluate */
+#define NOISE_ROW_LEVELS_MAX 32
+
+enum noise_type {
+	NOISE_STANDARD,
+	NOISE_FLIPFLOP,
+	NOISE_STANDARD_2D,
+};
+
+/* Maximum number of values noise_get_values_at_pos_multi can evaluate */
+#define NOISE_MULTI_MAX 8
+
+/* A noise value for noise_get_values_at_pos_multi to evaluate */
+struct noise_request {
+	enum noise_type type; /* NOISE_STANDARD or NOISE_FLIPFLOP */
+	uint32_t seed;
+	uint32_t levels;
+	uint32_t first; /* First octave to evaluate, see noise_octave_limit */
+};
+
+/* A 2d noise field for noise_get_row_2d to evaluate, made from octaves
+ * start to levels - 1 like noise_get_value_at_pos_standard_range_2d */
+struct noise_field_2d {
+	uint32_t seed;
+	uint32_t levels;
+	uint32_t start;
+};
+
+/* Lattice cell around a point at one octave, and its corner noise values */
+struct noise_row_cell {
+	uint32_t x, y, z;
+	peltar_noise corner[8];
+};
+
+/*
+ * Noise row walker.
+ *
+ * For evaluating noise at a series of nearby points, such as along a row
+ * of a texture.  Each octave keeps the corner values of the last lattice
+ * cell it used, and only rehashes them when a point lands in a different
+ * cell.  Results are identical to the equivalent noise_get_value_at_pos_*
+ * function.
+ */
+struct noise_row {
+	enum noise_type type;
+	bool range;
+	uint32_t seed;
+	uint32_t levels;
+	uint32_t start;
+	uint32_t first;
+	struct noise_row_cell cell[NOISE_ROW_LEVELS_MAX];
+};
+
+/* Gradient of a noise value, in noise units per FIX_MULTIPLE of position */
+struct noise_gradient {
+	int64_t x, y, z;
+};
+
+/* Permutation table hash tables, see noise-perm.c */
+extern const uint8_t noise_perm[512];
+extern const uint32_t noise_perm_value[256];
+
+/* Multiplicative lattice hash */
+static inline peltar_noise noise_random_mul(uint32_t x, uint32_t y,
+		uint32_t z, uint32_t seed)
 {
 	/* Note the primeness of constants here is crucial. */
 	peltar_noise n = (1619 * x) + (31337 * y) + (6971 * z) + (1013 * seed);
@@ -18,6 +89,43 @@ static inline peltar_noise noise_random(uint32_t x, uint32_t y, uint32_t z,
 	return n * (n * n * 60493 + 19990303) + 1376312589;
 }
 
+/* Perlin style permutation table lattice hash.  Repeats every 256 lattice
+ * cells along each axis. */
+static inline peltar_noise noise_random_perm(uint32_t x, uint32_t y,
+		uint32_t z, uint32_t seed)
+{
+	uint32_t h = seed ^ (seed >> 8) ^ (seed >> 16) ^ (seed >> 24);
+
+	h = noise_perm[h & 0xff];
+	h = noise_perm[h + (x & 0xff)];
+	h = noise_perm[h + (y & 0xff)];
+	h = noise_perm[h + (z & 0xff)];
+
+	/* Seeds which fold to the same byte still differ */
+	return noise_perm_value[h] ^ (seed * 0x9e3779b9);
+}
+
+/* Lattice hash used by the noise functions.  The multiplicative hash is
+ * the default; build with NOISE_HASH_PERM defined for the table hash. */
+static inline peltar_noise noise_random(uint32_t x, uint32_t y, uint32_t z,
+		uint32_t seed)
+{
+#ifdef NOISE_HASH_PERM
+	return noise_random_perm(x, y, z, seed);
+#else
+	return noise_random_mul(x, y, z, seed);
+#endif
+}
+
+/* Select the fade curve used by all the noise functions.  Defaults to
+ * NOISE_FADE_LINEAR. */
+void noise_set_fade(enum noise_fade fade);
+enum noise_fade noise_get_fade(void);
+
+/* Identify the noise functions' output, for keying caches of generated
+ * data.  Changes with the fade curve and with the lattice hash. */
+uint32_t noise_get_variant(void);
+
 /* 3d versions */
 peltar_noise noise_get_value_at_pos_standard(
 		struct point_3d p, uint32_t seed, uint32_t levels);
@@ -31,10 +139,84 @@ peltar_noise noise_get_value_at_pos_flipflop_range(
 		struct point_3d p, uint32_t seed,
 		uint32_t levels, uint32_t start);
 
+/*
+ * Octave culling.
+ *
+ * Get the first octave worth evaluating for a levels octave noise value,
+ * when each sample covers footprint (in FIX_MULTIPLE units of position)
+ * and only the top bits of the value are used.  Octaves with lattice
+ * cells smaller than the footprint, or which sum to less than one LSB of
+ * the output, are skipped.
+ *
+ * The _lod versions skip octaves below first, replacing them with their
+ * mean value, so the result's distribution stays centred.  With first as
+ * zero they are identical to the full versions.
+ */
+uint32_t noise_octave_limit(uint32_t levels, uint32_t footprint,
+		uint32_t bits);
+
+peltar_noise noise_get_value_at_pos_standard_lod(
+		struct point_3d p, uint32_t seed,
+		uint32_t levels, uint32_t first);
+peltar_noise noise_get_value_at_pos_flipflop_lod(
+		struct point_3d p, uint32_t seed,
+		uint32_t levels, uint32_t first);
+
+/* 3d batch versions: evaluate count points, writing results to out */
+void noise_get_values_at_pos_standard(
+		const struct point_3d *p, uint32_t count,
+		uint32_t seed, uint32_t levels,
+		peltar_noise *out);
+void noise_get_values_at_pos_flipflop(
+		const struct point_3d *p, uint32_t count,
+		uint32_t seed, uint32_t levels,
+		peltar_noise *out);
+void noise_get_values_at_pos_standard_lod(
+		const struct point_3d *p, uint32_t count,
+		uint32_t seed, uint32_t levels, uint32_t first,
+		peltar_noise *out);
+void noise_get_values_at_pos_flipflop_lod(
+		const struct point_3d *p, uint32_t count,
+		uint32_t seed, uint32_t levels, uint32_t first,
+		peltar_noise *out);
+
+/* 3d fused version: evaluate count different noise values at one point,
+ * sharing the per-octave setup.  Equivalent to calling the standard or
+ * flipflop _lod function for each request. */
+void noise_get_values_at_pos_multi(struct point_3d p,
+		const struct noise_request *req, uint32_t count,
+		peltar_noise *out);
+
+/* 3d versions which also get the value's analytic gradient.  The value is
+ * identical to the noise_get_value_at_pos_* equivalent. */
+peltar_noise noise_get_value_at_pos_standard_deriv(
+		struct point_3d p, uint32_t seed, uint32_t levels,
+		struct noise_gradient *grad);
+peltar_noise noise_get_value_at_pos_flipflop_deriv(
+		struct point_3d p, uint32_t seed, uint32_t levels,
+		struct noise_gradient *grad);
+
 /* 2d versions */
 peltar_noise noise_get_value_at_pos_standard_range_2d(
 		struct point_3d p, uint32_t seed,
 		uint32_t levels, uint32_t start);
 
+/* Row walker versions */
+void noise_row_init(struct noise_row *row, enum noise_type type,
+		uint32_t seed, uint32_t levels);
+void noise_row_init_range(struct noise_row *row, enum noise_type type,
+		uint32_t seed, uint32_t levels, uint32_t start);
+void noise_row_init_lod(struct noise_row *row, enum noise_type type,
+		uint32_t seed, uint32_t levels, uint32_t first);
+peltar_noise noise_row_get_value(struct noise_row *row, struct point_3d p);
+
+/* 2d scanline version: evaluate count fields at width points along a row,
+ * starting at x, y and stepping step along x.  Results for field j are
+ * written to out[j * width] onwards, and are identical to calling
+ * noise_get_value_at_pos_standard_range_2d for each point. */
+void noise_get_row_2d(const struct noise_field_2d *field, uint32_t count,
+		uint32_t x, uint32_t y, uint32_t step, uint32_t width,
+		peltar_noise *out);
+
 #endif
 
@@ -12,6 +12,7 @@
 #include "lib/cli.h"
 #include "lib/game.h"
 #include "lib/types.h"
+#include "noise/noise.h"
 
 #define MIN_SIZE 400
 
@@ -20,6 +21,17 @@ struct peltar_config peltar_opts = {
 	.screen_height = 700,
 	.screen_bpp   = 4,
 	.screen_depth = 32,
+	.fade = NOISE_FADE_LINEAR,
+};
+
+static const struct cli_str_val fade_values[] = {
+	{ .str = "linear",  .val = NOISE_FADE_LINEAR,
+	  .d = "Linear interpolation." },
+	{ .str = "cubic",   .val = NOISE_FADE_CUBIC,
+	  .d = "Cubic smoothstep curve." },
+	{ .str = "quintic", .val = NOISE_FADE_QUINTIC,
+	  .d = "Quintic smootherstep curve." },
+	{ .str = NULL },
 };
 
 static const struct cli_table_entry cli_entries[] = {
@@ -29,6 +41,15 @@ static const struct cli_table_entry cli_entries[] = {
 	  .d = "Window width in pixels." },
 	{ .l = "height",      .s = 'h', .t = CLI_UINT, .v.u = &peltar_opts.screen_height,
 	  .d = "Window height in pixels." },
+	{ .l = "threads",     .s = 't', .t = CLI_UINT, .v.u = &peltar_opts.threads,
+	  .d = "Texture generation threads, 0 for one per CPU." },
+	{ .l = "seed",        .s = 's', .t = CLI_UINT, .v.u = &peltar_opts.seed,
+	  .d = "Random seed, 0 for one from the time." },
+	{ .l = "cache",       .s = 'c', .t = CLI_STRING, .v.s = &peltar_opts.cache_dir,
+	  .d = "Directory to cache generated planet textures in." },
+	{ .l = "fade",        .s = 'F', .t = CLI_ENUM,
+	  .v.e = { .desc = fade_values, .e = &peltar_opts.fade },
+	  .d = "Noise fade curve for generated textures." },
 };
 
 const struct cli_table cli = {
@@ -76,7 +97,11 @@ int main(int argc, char *argv[])
 	}
 
 	/* Setup */
-	srand(time(NULL));
+	if (peltar_opts.seed != 0)
+		srand(peltar_opts.seed);
+	else
+		srand(time(NULL));
+	noise_set_fade(peltar_opts.fade);
 	game_init();
 
 	if (SDL_Init(SDL_INIT_VIDEO) < 0)
@@ -0,0 +1,571 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "../src/lib/cli.h"
+#include "../src/lib/types.h"
+#include "../src/noise/noise.h"
+
+#define BENCH_SEED 1234
+
+/* Fade option value for benchmarking every fade curve */
+#define BENCH_FADE_ALL -1
+
+static struct bench_options {
+	uint64_t count;
+	uint64_t levels;
+	int64_t fade;
+} opt = {
+	.count = 200000,
+	.levels = 0,
+	.fade = BENCH_FADE_ALL,
+};
+
+static const struct cli_str_val fade_values[] = {
+	{ .str = "linear",  .val = NOISE_FADE_LINEAR,
+	  .d = "Linear interpolation." },
+	{ .str = "cubic",   .val = NOISE_FADE_CUBIC,
+	  .d = "Cubic smoothstep curve." },
+	{ .str = "quintic", .val = NOISE_FADE_QUINTIC,
+	  .d = "Quintic smootherstep curve." },
+	{ .str = "all",     .val = BENCH_FADE_ALL,
+	  .d = "Each fade curve in turn." },
+	{ .str = NULL },
+};
+
+static const struct cli_table_entry cli_entries[] = {
+	{ .l = "count", .s = 'c', .t = CLI_UINT, .v.u = &opt.count,
+	  .d = "Number of samples to evaluate per measurement." },
+	{ .l = "levels", .s = 'l', .t = CLI_UINT, .v.u = &opt.levels,
+	  .d = "Number of noise octaves.  (Default: a range of counts.)" },
+	{ .l = "fade", .s = 'f', .t = CLI_ENUM,
+	  .v.e = { .desc = fade_values, .e = &opt.fade },
+	  .d = "Fade curve to benchmark." },
+};
+
+const struct cli_table cli = {
+	.entries = cli_entries,
+	.count = CLI_ARRAY_LEN(cli_entries),
+	.d = "Headless noise generation benchmark.",
+};
+
+static const char *fade_names[] = {
+	[NOISE_FADE_LINEAR]  = "linear",
+	[NOISE_FADE_CUBIC]   = "cubic",
+	[NOISE_FADE_QUINTIC] = "quintic",
+};
+
+/* Level counts the game's textures use */
+static const uint32_t default_levels[] = { 2, 3, 6, 8, 9, 11 };
+
+/* Octave to start at, for the range entry points */
+static inline uint32_t bench_start(uint32_t levels)
+{
+	return levels / 2;
+}
+
+/* First octave for the _lod entry points: an 8 bit output sampled every
+ * four lattice units */
+static inline uint32_t bench_first(uint32_t levels)
+{
+	return noise_octave_limit(levels, 4 << FIX_SHIFT, 8);
+}
+
+/*
+ * Entry point benchmarks.
+ *
+ * Each evaluates count samples and returns the number of noise values
+ * it generated.
+ */
+typedef uint32_t (*bench_fn)(const struct point_3d *p, uint32_t count,
+		uint32_t levels, peltar_noise *out);
+
+static uint32_t bench_standard(const struct point_3d *p, uint32_t count,
+		uint32_t levels, peltar_noise *out)
+{
+	for (uint32_t i = 0; i < count; i++)
+		out[i] = noise_get_value_at_pos_standard(p[i], BENCH_SEED,
+				levels);
+	return count;
+}
+
+static uint32_t bench_flipflop(const struct point_3d *p, uint32_t count,
+		uint32_t levels, peltar_noise *out)
+{
+	for (uint32_t i = 0; i < count; i++)
+		out[i] = noise_get_value_at_pos_flipflop(p[i], BENCH_SEED,
+				levels);
+	return count;
+}
+
+static uint32_t bench_standard_lod(const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	for (uint32_t i = 0; i < count; i++)
+		out[i] = noise_get_value_at_pos_standard_lod(p[i], BENCH_SEED,
+				levels, bench_first(levels));
+	return count;
+}
+
+static uint32_t bench_flipflop_lod(const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	for (uint32_t i = 0; i < count; i++)
+		out[i] = noise_get_value_at_pos_flipflop_lod(p[i], BENCH_SEED,
+				levels, bench_first(levels));
+	return count;
+}
+
+static uint32_t bench_standard_deriv(const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	struct noise_gradient grad;
+
+	for (uint32_t i = 0; i < count; i++) {
+		out[i] = noise_get_value_at_pos_standard_deriv(p[i],
+				BENCH_SEED, levels, &grad);
+		out[i] ^= grad.x ^ grad.y ^ grad.z;
+	}
+	return count;
+}
+
+static uint32_t bench_flipflop_deriv(const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	struct noise_gradient grad;
+
+	for (uint32_t i = 0; i < count; i++) {
+		out[i] = noise_get_value_at_pos_flipflop_deriv(p[i],
+				BENCH_SEED, levels, &grad);
+		out[i] ^= grad.x ^ grad.y ^ grad.z;
+	}
+	return count;
+}
+
+static uint32_t bench_standard_range(const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	for (uint32_t i = 0; i < count; i++)
+		out[i] = noise_get_value_at_pos_standard_range(p[i],
+				BENCH_SEED, levels, bench_start(levels));
+	return count;
+}
+
+static uint32_t bench_flipflop_range(const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	for (uint32_t i = 0; i < count; i++)
+		out[i] = noise_get_value_at_pos_flipflop_range(p[i],
+				BENCH_SEED, levels, bench_start(levels));
+	return count;
+}
+
+static uint32_t bench_standard_range_2d(const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	for (uint32_t i = 0; i < count; i++)
+		out[i] = noise_get_value_at_pos_standard_range_2d(p[i],
+				BENCH_SEED, levels, bench_start(levels));
+	return count;
+}
+
+static uint32_t bench_batch_standard(const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	noise_get_values_at_pos_standard(p, count, BENCH_SEED, levels, out);
+	return count;
+}
+
+static uint32_t bench_batch_flipflop(const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	noise_get_values_at_pos_flipflop(p, count, BENCH_SEED, levels, out);
+	return count;
+}
+
+static uint32_t bench_batch_standard_lod(const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	noise_get_values_at_pos_standard_lod(p, count, BENCH_SEED, levels,
+			bench_first(levels), out);
+	return count;
+}
+
+static uint32_t bench_batch_flipflop_lod(const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	noise_get_values_at_pos_flipflop_lod(p, count, BENCH_SEED, levels,
+			bench_first(levels), out);
+	return count;
+}
+
+static uint32_t bench_multi(const struct point_3d *p, uint32_t count,
+		uint32_t levels, peltar_noise *out)
+{
+	const struct noise_request req[2] = {
+		{ NOISE_STANDARD, BENCH_SEED,     levels, 0 },
+		{ NOISE_FLIPFLOP, BENCH_SEED + 1, levels, 0 },
+	};
+	peltar_noise value[2];
+
+	for (uint32_t i = 0; i < count; i++) {
+		noise_get_values_at_pos_multi(p[i], req, 2, value);
+		out[i] = value[0] ^ value[1];
+	}
+	return count * 2;
+}
+
+static uint32_t bench_row(const struct point_3d *p, uint32_t count,
+		struct noise_row *row, peltar_noise *out)
+{
+	for (uint32_t i = 0; i < count; i++)
+		out[i] = noise_row_get_value(row, p[i]);
+	return count;
+}
+
+static uint32_t bench_row_standard(const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	struct noise_row row;
+
+	noise_row_init(&row, NOISE_STANDARD, BENCH_SEED, levels);
+	return bench_row(p, count, &row, out);
+}
+
+static uint32_t bench_row_flipflop(const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	struct noise_row row;
+
+	noise_row_init(&row, NOISE_FLIPFLOP, BENCH_SEED, levels);
+	return bench_row(p, count, &row, out);
+}
+
+static uint32_t bench_row_lod(const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	struct noise_row row;
+
+	noise_row_init_lod(&row, NOISE_STANDARD, BENCH_SEED, levels,
+			bench_first(levels));
+	return bench_row(p, count, &row, out);
+}
+
+static uint32_t bench_row_standard_2d(const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	struct noise_row row;
+
+	noise_row_init_range(&row, NOISE_STANDARD_2D, BENCH_SEED, levels,
+			bench_start(levels));
+	return bench_row(p, count, &row, out);
+}
+
+static uint32_t bench_scanline_2d(const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	const struct noise_field_2d field = {
+		BENCH_SEED, levels, bench_start(levels)
+	};
+	uint32_t i, width;
+
+	/* Whole rows at a time, starting at each row's first point */
+	for (i = 0; i < count; i += width) {
+		width = (count - i < 1024) ? count - i : 1024;
+		noise_get_row_2d(&field, 1, p[i].x, p[i].y, FIX_MULTIPLE,
+				width, out + i);
+	}
+	return count;
+}
+
+static const struct bench_entry {
+	const char *name;
+	bench_fn fn;
+} entries[] = {
+	{ "standard_3d",          bench_standard },
+	{ "flipflop_3d",          bench_flipflop },
+	{ "standard_lod_3d",      bench_standard_lod },
+	{ "flipflop_lod_3d",      bench_flipflop_lod },
+	{ "standard_deriv_3d",    bench_standard_deriv },
+	{ "flipflop_deriv_3d",    bench_flipflop_deriv },
+	{ "standard_range_3d",    bench_standard_range },
+	{ "flipflop_range_3d",    bench_flipflop_range },
+	{ "standard_range_2d",    bench_standard_range_2d },
+	{ "batch_standard_3d",    bench_batch_standard },
+	{ "batch_flipflop_3d",    bench_batch_flipflop },
+	{ "batch_standard_lod_3d", bench_batch_standard_lod },
+	{ "batch_flipflop_lod_3d", bench_batch_flipflop_lod },
+	{ "multi_3d",             bench_multi },
+	{ "row_standard_3d",      bench_row_standard },
+	{ "row_flipflop_3d",      bench_row_flipflop },
+	{ "row_lod_3d",           bench_row_lod },
+	{ "row_standard_range_2d", bench_row_standard_2d },
+	{ "scanline_range_2d",    bench_scanline_2d },
+};
+
+struct bench_result {
+	const char *fade;
+	const char *entry;
+	uint32_t levels;
+	double ns;
+};
+
+/*
+ * Lattice hash comparison.
+ */
+typedef peltar_noise (*hash_fn)(uint32_t x, uint32_t y, uint32_t z,
+		uint32_t seed);
+
+static const struct bench_hash {
+	const char *name;
+	hash_fn fn;
+} hashes[] = {
+	{ "mul",  noise_random_mul },
+	{ "perm", noise_random_perm },
+};
+
+struct bench_hash_result {
+	double ns;
+	double avalanche;
+	double chi2;
+};
+
+static inline uint32_t bench_popcount(uint32_t v)
+{
+	uint32_t count = 0;
+
+	for (; v != 0; v &= v - 1)
+		count++;
+
+	return count;
+}
+
+static inline uint32_t bench_lcg(uint32_t *state)
+{
+	*state = *state * 1664525 + 1013904223;
+	return *state;
+}
+
+/* Somewhere for bench_hash_time's sum to go, so the hashing isn't
+ * optimised away */
+static volatile uint32_t bench_hash_sink;
+
+/* Time hashing the corners of count cells along a row, as the noise
+ * functions do */
+static inline double bench_hash_time(hash_fn fn, uint32_t count)
+{
+	clock_t start = clock();
+	uint32_t sum = 0;
+
+	for (uint32_t x = 0; x < count; x++) {
+		for (uint32_t c = 0; c < 8; c++) {
+			sum = ((sum << 1) | (sum >> 31)) ^ fn(x + (c & 1),
+					7 + ((c >> 1) & 1), 11 + (c >> 2),
+					BENCH_SEED);
+		}
+	}
+
+	bench_hash_sink = sum;
+
+	return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / count / 8;
+}
+
+/* Mean fraction of output bits changed by flipping each bit of the low
+ * byte of the lattice coordinates.  Ideally 0.5. */
+static inline double bench_hash_avalanche(hash_fn fn, uint32_t count)
+{
+	uint32_t state = 1, flipped = 0;
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t c[3], seed, h;
+
+		c[0] = bench_lcg(&state) >> 16;
+		c[1] = bench_lcg(&state) >> 16;
+		c[2] = bench_lcg(&state) >> 16;
+		seed = bench_lcg(&state);
+
+		h = fn(c[0], c[1], c[2], seed);
+
+		for (uint32_t axis = 0; axis < 3; axis++) {
+			for (uint32_t bit = 0; bit < 8; bit++) {
+				uint32_t d[3] = { c[0], c[1], c[2] };
+
+				d[axis] ^= 1u << bit;
+				flipped += bench_popcount(h ^
+						fn(d[0], d[1], d[2], seed));
+			}
+		}
+	}
+
+	return flipped / (32.0 * 24 * count);
+}
+
+/* Chi-squared per degree of freedom for the top byte of the hash over a
+ * block of lattice points.  Ideally close to 1. */
+static inline double bench_hash_uniformity(hash_fn fn)
+{
+	static uint32_t bins[256];
+	const uint32_t size = 64;
+	double expected, chi2 = 0;
+
+	for (uint32_t i = 0; i < 256; i++)
+		bins[i] = 0;
+
+	for (uint32_t z = 0; z < size; z++)
+		for (uint32_t y = 0; y < size; y++)
+			for (uint32_t x = 0; x < size; x++)
+				bins[fn(x, y, z, BENCH_SEED) >> 24]++;
+
+	expected = size * size * size / 256.0;
+	for (uint32_t i = 0; i < 256; i++) {
+		double d = bins[i] - expected;
+		chi2 += d * d / expected;
+	}
+
+	return chi2 / 255;
+}
+
+static void bench_hashes(uint32_t count,
+		struct bench_hash_result res[CLI_ARRAY_LEN(hashes)])
+{
+#ifdef NOISE_HASH_PERM
+	printf("noise hash: perm\n");
+#else
+	printf("noise hash: mul\n");
+#endif
+	printf("  %-22s %7s %9s %9s\n", "hash",
+			"ns", "avalanche", "chi2/dof");
+
+	for (uint32_t i = 0; i < CLI_ARRAY_LEN(hashes); i++) {
+		res[i].ns = bench_hash_time(hashes[i].fn, count);
+		res[i].avalanche = bench_hash_avalanche(hashes[i].fn,
+				count / 16 + 1);
+		res[i].chi2 = bench_hash_uniformity(hashes[i].fn);
+
+		printf("  %-22s %7.2f %9.4f %9.3f\n", hashes[i].name,
+				res[i].ns, res[i].avalanche, res[i].chi2);
+	}
+	printf("\n");
+}
+
+/* Points in texture order; rows of 1024 one pixel apart */
+static void bench_get_points(struct point_3d *p, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		p[i].x = (i % 1024) << FIX_SHIFT;
+		p[i].y = (i / 1024) << FIX_SHIFT;
+		p[i].z = (200 << FIX_SHIFT) + i * 37;
+	}
+}
+
+static double bench_run(bench_fn fn, const struct point_3d *p,
+		uint32_t count, uint32_t levels, peltar_noise *out)
+{
+	clock_t start = clock();
+	uint32_t values;
+
+	values = fn(p, count, levels, out);
+
+	return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / values;
+}
+
+int main(int argc, char *argv[])
+{
+	const uint32_t *levels = default_levels;
+	uint32_t levels_count = CLI_ARRAY_LEN(default_levels);
+	uint32_t fade_first = 0, fade_last = CLI_ARRAY_LEN(fade_names);
+	struct bench_hash_result hash_results[CLI_ARRAY_LEN(hashes)];
+	struct bench_result *results;
+	uint32_t results_count = 0;
+	uint32_t single_level;
+	struct point_3d *p;
+	peltar_noise *out;
+	uint32_t count;
+
+	if (!cli_parse(&cli, argc, (void *)argv)) {
+		cli_help(&cli, argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (opt.levels > NOISE_ROW_LEVELS_MAX || opt.count == 0) {
+		cli_help(&cli, argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (opt.levels != 0) {
+		single_level = opt.levels;
+		levels = &single_level;
+		levels_count = 1;
+	}
+
+	if (opt.fade != BENCH_FADE_ALL) {
+		fade_first = opt.fade;
+		fade_last = opt.fade + 1;
+	}
+
+	count = opt.count;
+	p = malloc(count * sizeof(*p));
+	out = malloc(count * sizeof(*out));
+	results = malloc((fade_last - fade_first) * levels_count *
+			CLI_ARRAY_LEN(entries) * sizeof(*results));
+	if (p == NULL || out == NULL || results == NULL) {
+		free(p);
+		free(out);
+		free(results);
+		return EXIT_FAILURE;
+	}
+
+	bench_get_points(p, count);
+	bench_hashes(count, hash_results);
+
+	for (uint32_t fade = fade_first; fade < fade_last; fade++) {
+		noise_set_fade(fade);
+
+		printf("fade: %s\n", fade_names[fade]);
+		printf("  %-22s", "levels");
+		for (uint32_t l = 0; l < levels_count; l++)
+			printf(" %7u", levels[l]);
+		printf("\n");
+
+		for (uint32_t e = 0; e < CLI_ARRAY_LEN(entries); e++) {
+			printf("  %-22s", entries[e].name);
+
+			for (uint32_t l = 0; l < levels_count; l++) {
+				struct bench_result *r;
+
+				r = &results[results_count++];
+				r->fade = fade_names[fade];
+				r->entry = entries[e].name;
+				r->levels = levels[l];
+				r->ns = bench_run(entries[e].fn, p, count,
+						levels[l], out);
+
+				printf(" %7.1f", r->ns);
+				fflush(stdout);
+			}
+			printf("\n");
+		}
+		printf("\n");
+	}
+
+	/* Machine readable summary, for comparing builds */
+	printf("# hash,ns_per_hash,avalanche,chi2_per_dof\n");
+	for (uint32_t i = 0; i < CLI_ARRAY_LEN(hashes); i++) {
+		printf("%s,%.2f,%.4f,%.3f\n", hashes[i].name,
+				hash_results[i].ns, hash_results[i].avalanche,
+				hash_results[i].chi2);
+	}
+
+	printf("# fade,entry,levels,ns_per_sample\n");
+	for (uint32_t i = 0; i < results_count; i++) {
+		printf("%s,%s,%u,%.2f\n", results[i].fade, results[i].entry,
+				results[i].levels, results[i].ns);
+	}
+
+	free(p);
+	free(out);
+	free(results);
+
+	return EXIT_SUCCESS;
+}
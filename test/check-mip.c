@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "../src/lib/cli.h"
+#include "../src/lib/planet-simd.h"
+
+/* Texels either side of each output row, to catch writes out of range */
+#define CHECK_GUARD 16
+#define CHECK_SENTINEL 0xdeadbeef
+
+/* Longest output row to check, in texels */
+#define CHECK_COUNT_MAX 200
+
+static struct check_options {
+	uint64_t rounds;
+	uint64_t seed;
+} opt = {
+	.rounds = 2000,
+	.seed = 1,
+};
+
+static const struct cli_table_entry cli_entries[] = {
+	{ .l = "rounds", .s = 'r', .t = CLI_UINT, .v.u = &opt.rounds,
+	  .d = "Number of random rows to check each kernel with." },
+	{ .l = "seed", .s = 's', .t = CLI_UINT, .v.u = &opt.seed,
+	  .d = "Random seed." },
+};
+
+const struct cli_table cli = {
+	.entries = cli_entries,
+	.count = CLI_ARRAY_LEN(cli_entries),
+	.d = "Headless check of the SIMD mip kernels against scalar code.",
+};
+
+static inline uint32_t check_lcg(uint32_t *state)
+{
+	*state = *state * 1664525 + 1013904223;
+	return *state;
+}
+
+/* A random texel.  Mostly full range, but with runs of extreme channel
+ * values, where rounding and overflow mistakes show */
+static inline uint32_t check_texel(uint32_t *state)
+{
+	uint32_t v = check_lcg(state);
+
+	switch (v & 0x7) {
+	case 0:
+		return 0xffffffff;
+	case 1:
+		return 0x00000000;
+	case 2:
+		return (v & 0x1) ? 0xff00ff00 : 0x00ff00ff;
+	default:
+		return v ^ (check_lcg(state) >> 16);
+	}
+}
+
+/* Rows of a texture with random texels, and row span span.  There's nothing
+ * after the last row, so memory checkers can catch reads past it */
+static uint32_t *check_rows(uint32_t *state, int rows, int span)
+{
+	int len = rows * span;
+	uint32_t *buf = malloc(len * sizeof(*buf));
+	int i;
+
+	if (buf == NULL)
+		return NULL;
+
+	for (i = 0; i < len; i++)
+		buf[i] = check_texel(state);
+
+	return buf;
+}
+
+static void check_fill(uint32_t *buf, int len)
+{
+	for (int i = 0; i < len; i++)
+		buf[i] = CHECK_SENTINEL;
+}
+
+/* Check texels got[0] to got[count], and that the kernel left the rest of
+ * the row, up to max, and its guards alone */
+static bool check_row(const char *what, const uint32_t *got,
+		const uint32_t *want, int count, int max, int round)
+{
+	int x;
+
+	for (x = -CHECK_GUARD; x < max + CHECK_GUARD; x++) {
+		uint32_t expect = (x >= 0 && x < count) ?
+				want[x] : CHECK_SENTINEL;
+
+		if (got[x] != expect) {
+			printf("FAIL: %s, round %d, texel %d of %d: "
+					"%08" PRIx32 ", expected %08" PRIx32
+					"\n", what, round, x, count,
+					got[x], expect);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Check planet_simd_mip_row on a random row pair.  Returns the number of
+ * texels the kernel made, or -1 on a mismatch */
+static int check_mip_row(uint32_t *state, int round)
+{
+	int count = 1 + check_lcg(state) % CHECK_COUNT_MAX;
+	int span = 2 * count + check_lcg(state) % 9;
+	uint32_t want[CHECK_COUNT_MAX];
+	uint32_t got[CHECK_COUNT_MAX + 2 * CHECK_GUARD];
+	uint32_t *in;
+	int n, x;
+
+	in = check_rows(state, 2, span);
+	if (in == NULL)
+		return -1;
+
+	check_fill(got, CLI_ARRAY_LEN(got));
+
+	n = planet_simd_mip_row(in, in + span, got + CHECK_GUARD, count);
+	if (n < 0 || n > count) {
+		printf("FAIL: mip_row, round %d: made %d of %d texels\n",
+				round, n, count);
+		free(in);
+		return -1;
+	}
+
+	for (x = 0; x < n; x++)
+		want[x] = planet_make_mip_px(in + 2 * x, span);
+
+	if (!check_row("mip_row", got + CHECK_GUARD, want, n, count, round))
+		n = -1;
+
+	free(in);
+	return n;
+}
+
+/* Check planet_simd_mip_rows_4x on four random rows.  Returns the number of
+ * texels of the second level the kernel made, or -1 on a mismatch */
+static int check_mip_rows_4x(uint32_t *state, int round)
+{
+	int count = 1 + check_lcg(state) % CHECK_COUNT_MAX;
+	int span = 4 * count + check_lcg(state) % 9;
+	uint32_t want_mid[2][2 * CHECK_COUNT_MAX];
+	uint32_t want[CHECK_COUNT_MAX];
+	uint32_t got_mid[2][2 * CHECK_COUNT_MAX + 2 * CHECK_GUARD];
+	uint32_t got[CHECK_COUNT_MAX + 2 * CHECK_GUARD];
+	const uint32_t *rows[4];
+	uint32_t *mid[2];
+	uint32_t *in;
+	int n, x, i;
+	bool ok;
+
+	in = check_rows(state, 4, span);
+	if (in == NULL)
+		return -1;
+
+	for (i = 0; i < 4; i++)
+		rows[i] = in + i * span;
+
+	for (i = 0; i < 2; i++) {
+		check_fill(got_mid[i], CLI_ARRAY_LEN(got_mid[i]));
+		mid[i] = got_mid[i] + CHECK_GUARD;
+	}
+	check_fill(got, CLI_ARRAY_LEN(got));
+
+	n = planet_simd_mip_rows_4x(rows, mid, got + CHECK_GUARD, count);
+	if (n < 0 || n > count) {
+		printf("FAIL: mip_rows_4x, round %d: made %d of %d texels\n",
+				round, n, count);
+		free(in);
+		return -1;
+	}
+
+	/* The levels one after the other, as planet_make_mip_texture */
+	for (i = 0; i < 2; i++)
+		for (x = 0; x < 2 * n; x++)
+			want_mid[i][x] = planet_make_mip_px(
+					rows[2 * i] + 2 * x, span);
+
+	for (x = 0; x < n; x++)
+		want[x] = planet_make_mip_px(want_mid[0] + 2 * x,
+				CLI_ARRAY_LEN(want_mid[0]));
+
+	ok = check_row("mip_rows_4x mid 0", mid[0], want_mid[0],
+			2 * n, 2 * count, round) &&
+			check_row("mip_rows_4x mid 1", mid[1], want_mid[1],
+			2 * n, 2 * count, round) &&
+			check_row("mip_rows_4x", got + CHECK_GUARD, want,
+			n, count, round);
+
+	free(in);
+	return ok ? n : -1;
+}
+
+int main(int argc, char *argv[])
+{
+	uint64_t made_row = 0, made_4x = 0;
+	uint32_t state;
+	int n;
+
+	if (!cli_parse(&cli, argc, (void *)argv)) {
+		cli_help(&cli, argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	state = opt.seed;
+
+	for (uint64_t round = 0; round < opt.rounds; round++) {
+		n = check_mip_row(&state, (int)round);
+		if (n < 0)
+			return EXIT_FAILURE;
+		made_row += n;
+
+		n = check_mip_rows_4x(&state, (int)round);
+		if (n < 0)
+			return EXIT_FAILURE;
+		made_4x += n;
+	}
+
+	if (made_row == 0 && made_4x == 0) {
+		printf("No SIMD mip kernels on this CPU; nothing to check\n");
+		return EXIT_SUCCESS;
+	}
+
+	printf("mip_row:     %" PRIu64 " rows, %" PRIu64 " texels match\n",
+			opt.rounds, made_row);
+	printf("mip_rows_4x: %" PRIu64 " rows, %" PRIu64 " texels match\n",
+			opt.rounds, made_4x);
+
+	return EXIT_SUCCESS;
+}
@@ -2,6 +2,7 @@
 #include <time.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <inttypes.h>
 #include <SDL/SDL.h>
 #include <SDL/SDL_image.h>
 
@@ -15,8 +16,14 @@ static struct peltar_options {
 	bool time;
 	bool generate;
 	bool lighting;
+	bool full;
+	bool bilinear;
+	bool hash;
 	uint64_t count;
 	uint64_t radius;
+	uint64_t diameter;
+	uint64_t threads;
+	uint64_t seed;
 } opt = {
 	.time = false,
 	.count = 50000,
@@ -30,10 +37,22 @@ static const struct cli_table_entry cli_entries[] = {
 	  .d = "Number of frames to render before exiting. " },
 	{ .l = "radius", .s = 'r', .t = CLI_UINT, .v.u = &opt.radius,
 	  .d = "Radius of planet in pixels." },
+	{ .l = "diameter", .s = 'd', .t = CLI_UINT, .v.u = &opt.diameter,
+	  .d = "Render at this diameter, rather than the planet's size." },
 	{ .l = "generate", .s = 'g', .t = CLI_BOOL, .v.b = &opt.generate,
 	  .d = "Generate texture instead of loading file." },
 	{ .l = "lighting", .s = 'l', .t = CLI_BOOL, .v.b = &opt.lighting,
 	  .d = "Enable lighting render mode." },
+	{ .l = "full", .s = 'f', .t = CLI_BOOL, .v.b = &opt.full,
+	  .d = "Redraw the whole planet every frame." },
+	{ .l = "bilinear", .s = 'b', .t = CLI_BOOL, .v.b = &opt.bilinear,
+	  .d = "Filter the texture file bilinearly when resampling it." },
+	{ .l = "threads", .s = 'j', .t = CLI_UINT, .v.u = &opt.threads,
+	  .d = "Texture generation threads, 0 for one per CPU." },
+	{ .l = "seed", .s = 's', .t = CLI_UINT, .v.u = &opt.seed,
+	  .d = "Random seed for generated textures, 0 for one from the time." },
+	{ .l = "hash", .s = 'x', .t = CLI_BOOL, .v.b = &opt.hash,
+	  .d = "Print a hash of the whole texture and exit." },
 };
 
 const struct cli_table cli = {
@@ -41,11 +60,62 @@ const struct cli_table cli = {
 	.count = (sizeof(cli_entries))/(sizeof(*cli_entries)),
 };
 
+/* FNV-1a hash of the texture, plotted to a blank surface.  Textures must
+ * be the same whatever the number of threads generating them. */
+static bool texture_hash(SDL_Surface *screen, struct planet *planet,
+		uint64_t *hash)
+{
+	int size = planet_get_size(planet);
+	SDL_Surface *surface;
+	int x, y;
+
+	surface = SDL_CreateRGBSurface(SDL_SWSURFACE, size * 4, size,
+			peltar_opts.screen_depth,
+			screen->format->Rmask, screen->format->Gmask,
+			screen->format->Bmask, screen->format->Amask);
+	if (surface == NULL)
+		return false;
+
+	planet_plot_texture(planet, surface, 0, 0);
+
+	*hash = 0xcbf29ce484222325;
+	for (y = 0; y < surface->h; y++) {
+		const uint8_t *row = (const uint8_t *)surface->pixels +
+				y * surface->pitch;
+
+		for (x = 0; x < surface->w * 4; x++) {
+			*hash ^= row[x];
+			*hash *= 0x100000001b3;
+		}
+	}
+
+	SDL_FreeSurface(surface);
+
+	return true;
+}
+
+static inline bool planet_draw(SDL_Surface* screen, struct planet *planet,
+		int x, int y)
+{
+	if (opt.full)
+		planet_invalidate_render(planet);
+
+	if (opt.diameter != 0)
+		return planet_update_render_size(planet, screen, x, y,
+				opt.diameter);
+
+	planet_update_render(planet, screen, x, y);
+
+	return true;
+}
+
 static inline bool screen_draw(SDL_Surface* screen, struct planet *planet)
 {
+	int size = (opt.diameter != 0) ? opt.diameter : opt.radius * 2;
+	bool drawn;
 	SDL_Rect rect = {
-		.x = (screen->w - opt.radius * 2) / 2,
-		.y = (screen->h - opt.radius * 2) / 2,
+		.x = (screen->w - size) / 2,
+		.y = (screen->h - size) / 2,
 		.w = 0,
 		.h = 0
 	};
@@ -55,11 +125,14 @@ static inline bool screen_draw(SDL_Surface* screen, struct planet *planet)
 			return false;
 	}
 
-	planet_update_render(planet, screen, rect.x, rect.y);
+	drawn = planet_draw(screen, planet, rect.x, rect.y);
 
 	if (SDL_MUSTLOCK(screen))
 		SDL_UnlockSurface(screen);
 
+	if (!drawn)
+		return false;
+
 	SDL_Flip(screen);
 
 	return true;
@@ -77,10 +150,16 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
-	peltar_opts.screen_width = opt.radius * 9 / 4;
-	peltar_opts.screen_height = opt.radius * 9 / 4;
+	if (opt.diameter > opt.radius * 2) {
+		peltar_opts.screen_width = opt.diameter * 9 / 8;
+		peltar_opts.screen_height = opt.diameter * 9 / 8;
+	} else {
+		peltar_opts.screen_width = opt.radius * 9 / 4;
+		peltar_opts.screen_height = opt.radius * 9 / 4;
+	}
 	peltar_opts.screen_bpp = 4;
 	peltar_opts.screen_depth = 32;
+	peltar_opts.threads = opt.threads;
 
 	planet_init();
 
@@ -104,17 +183,33 @@ int main(int argc, char *argv[])
 	}
 
 	if (opt.generate) {
-		srand(time(NULL));
+		srand(opt.seed != 0 ? opt.seed : (uint64_t)time(NULL));
 		if (!planet_generate_texture(planet, screen)) {
 			SDL_Quit();
 			return EXIT_FAILURE;
 		}
 	} else {
 		if (!planet_get_texture_from_file(planet,
-				"test/texture.png", screen)) {
+				"test/texture.png", screen, opt.bilinear ?
+				PLANET_FILTER_BILINEAR :
+				PLANET_FILTER_NEAREST)) {
+			SDL_Quit();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (opt.hash) {
+		uint64_t hash;
+
+		if (!texture_hash(screen, planet, &hash)) {
 			SDL_Quit();
 			return EXIT_FAILURE;
 		}
+		printf("Texture hash: %016" PRIx64 "\n", hash);
+
+		planet_free(planet);
+		SDL_Quit();
+		return EXIT_SUCCESS;
 	}
 
 	if (opt.lighting) {
@@ -123,7 +218,10 @@ int main(int argc, char *argv[])
 
 	if (opt.time) {
 		for (uint64_t i = 0; i < opt.count; i++) {
-			planet_update_render(planet, screen, 0, 0);
+			if (!planet_draw(screen, planet, 0, 0)) {
+				SDL_Quit();
+				return EXIT_FAILURE;
+			}
 		}
 	} else {
 		while (!keypress) {
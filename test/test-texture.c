@@ -161,7 +161,8 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
-	if (!planet_get_texture_from_file(p1, "test/texture.png", screen)) {
+	if (!planet_get_texture_from_file(p1, "test/texture.png", screen,
+			PLANET_FILTER_NEAREST)) {
 		SDL_Quit();
 		return EXIT_FAILURE;
 	}